@@ -1,13 +1,14 @@
 # SPDX-FileCopyrightText: 2021-2025 Alyssa Ross <hi@alyssa.is>
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
 # SPDX-License-Identifier: MIT
 
 import ../../lib/call-package.nix (
-{ src, spectrum-build-tools, rootfs
+{ src, spectrum-build-tools, spectrum-initramfs-tools, rootfs
 , lib, stdenvNoCC, makeModulesClosure, runCommand, writeClosure, pkgsStatic
 , busybox, cpio, microcode-amd, microcode-intel
 }:
 
-pkgsStatic.callPackage ({ execline, kmod, mdevd, cryptsetup, util-linuxMinimal }:
+pkgsStatic.callPackage ({ stdenv, execline, kmod, mdevd, util-linuxMinimal }:
 
 let
   inherit (lib) concatMapStringsSep filter foldl isString last split tail;
@@ -25,13 +26,7 @@ let
   packages = [
     execline kmod mdevd
 
-    (cryptsetup.override {
-      programs = {
-        cryptsetup = false;
-        cryptsetup-reencrypt = false;
-        integritysetup = false;
-      };
-    })
+    (spectrum-initramfs-tools.override { inherit stdenv; })
 
     (busybox.override {
       enableStatic = true;
@@ -56,7 +51,7 @@ let
     # TODO: this is a hack and we should just build the util-linux
     # programs we want.
     # https://lore.kernel.org/util-linux/87zgrl6ufb.fsf@alyssa.is/
-    cp ${util-linuxMinimal}/bin/{findfs,lsblk} $out/bin
+    cp ${util-linuxMinimal}/bin/lsblk $out/bin
   '';
 
   microcode = runCommand "microcode.cpio" {
@@ -13,8 +13,9 @@ pkgsMusl.callPackage (
 , btrfs-progs, bubblewrap, busybox, cloud-hypervisor, cosmic-files
 , crosvm, cryptsetup, dejavu_fonts, dbus, execline, foot, fuse3
 , iproute2, inotify-tools, jq, kmod, lvm2, mdevd, mesa, mount-flatpak
-, s6, s6-linux-init, shadow, socat, systemd, util-linuxMinimal, virtiofsd
-, westonLite, xdg-desktop-portal, xdg-desktop-portal-gtk
+, s6, s6-linux-init, shadow, socat, squashfsTools, systemd
+, util-linuxMinimal, virtiofsd, westonLite, xdg-desktop-portal
+, xdg-desktop-portal-gtk
 , xdg-desktop-portal-spectrum-host
 }:
 
@@ -26,9 +27,9 @@ let
 
   packages = [
     btrfs-progs bubblewrap cloud-hypervisor cosmic-files crosvm cryptsetup dbus
-    execline fuse3 inotify-tools iproute2 jq kmod mdevd mount-flatpak s6
-    s6-linux-init s6-rc shadow socat spectrum-host-tools spectrum-router
-    virtiofsd xdg-desktop-portal-spectrum-host
+    erofs-utils execline fuse3 inotify-tools iproute2 jq kmod mdevd
+    mount-flatpak s6 s6-linux-init s6-rc shadow socat spectrum-host-tools
+    spectrum-router squashfsTools virtiofsd xdg-desktop-portal-spectrum-host
 
     (foot.override { allowPgo = false; })
 
@@ -128,12 +129,18 @@ stdenvNoCC.mkDerivation {
       printf "%s\n/\n" ${packagesSysroot} >$out
       sed p ${writeClosure [ packagesSysroot] } >>$out
     '';
+    READAHEAD_PROFILE = lib.optionalString (config.readaheadProfile != null)
+      (builtins.path {
+        name = "readahead-profile";
+        path = config.readaheadProfile;
+      });
     UPDATE_SIGNING_KEY = builtins.path {
       name = "signing-key";
       path = config.updateSigningKey;
     };
     UPDATE_URL = config.updateUrl;
     VERSION = config.version;
+    VM_POOL_SIZE = toString config.vmPoolSize;
   };
 
   # The Makefile uses $(ROOT_FS), not $(dest), so it can share code
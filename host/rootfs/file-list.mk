@@ -63,11 +63,18 @@ FILES = \
 	image/usr/bin/run-flatpak \
 	image/usr/bin/run-vmm \
 	image/usr/bin/spectrum-update \
+	image/usr/bin/transient-vm-create \
+	image/usr/bin/transient-vm-destroy \
+	image/usr/bin/transient-vm-run \
 	image/usr/bin/vm-console \
 	image/usr/bin/vm-import \
+	image/usr/bin/vm-pool-fill \
+	image/usr/bin/vm-pool-init \
+	image/usr/bin/vm-pool-take \
 	image/usr/bin/vm-start \
 	image/usr/bin/vm-stop \
 	image/usr/bin/xdg-open \
+	image/usr/lib/spectrum/vm-pool/template/pool-template \
 	image/usr/libexec/net-add \
 	image/usr/share/dbus-1/services/org.freedesktop.portal.Documents.service
 
@@ -79,14 +86,19 @@ LINKS = \
 	image/etc/s6-linux-init/run-image/service/vmm/template/run \
 	image/lib \
 	image/sbin \
-	image/usr/bin/systemd-udevd
+	image/usr/bin/systemd-udevd \
+	image/usr/lib/spectrum/vm-pool/template/pmem \
+	image/usr/lib/spectrum/vm-pool/template/vmlinux
 
 S6_RC_FILES = \
 	image/etc/s6-rc/core/type \
 	image/etc/s6-rc/core/up \
 	image/etc/s6-rc/ok-all/contents.d/sys-vmms \
 	image/etc/s6-rc/ok-all/contents.d/systemd-udevd-coldplug \
+	image/etc/s6-rc/ok-all/contents.d/vm-balloon \
 	image/etc/s6-rc/ok-all/contents.d/vm-env \
+	image/etc/s6-rc/ok-all/contents.d/vm-idle \
+	image/etc/s6-rc/ok-all/contents.d/vm-pool \
 	image/etc/s6-rc/ok-all/type \
 	image/etc/s6-rc/static-nodes/type \
 	image/etc/s6-rc/static-nodes/up \
@@ -99,13 +111,24 @@ S6_RC_FILES = \
 	image/etc/s6-rc/systemd-udevd/notification-fd \
 	image/etc/s6-rc/systemd-udevd/run \
 	image/etc/s6-rc/systemd-udevd/type \
+	image/etc/s6-rc/vm-balloon/run \
+	image/etc/s6-rc/vm-balloon/type \
 	image/etc/s6-rc/vm-env/contents.d/static-nodes \
 	image/etc/s6-rc/vm-env/contents.d/systemd-udevd-coldplug \
 	image/etc/s6-rc/vm-env/contents.d/weston \
 	image/etc/s6-rc/vm-env/type \
+	image/etc/s6-rc/vm-idle/run \
+	image/etc/s6-rc/vm-idle/type \
+	image/etc/s6-rc/vm-pool/dependencies.d/vmm-env \
+	image/etc/s6-rc/vm-pool/run \
+	image/etc/s6-rc/vm-pool/type \
+	image/etc/s6-rc/vm-registry/notification-fd \
+	image/etc/s6-rc/vm-registry/run \
+	image/etc/s6-rc/vm-registry/type \
 	image/etc/s6-rc/vmm-env/contents.d/core \
 	image/etc/s6-rc/vmm-env/contents.d/static-nodes \
 	image/etc/s6-rc/vmm-env/contents.d/systemd-udevd-coldplug \
+	image/etc/s6-rc/vmm-env/contents.d/vm-registry \
 	image/etc/s6-rc/vmm-env/type \
 	image/etc/s6-rc/weston/dependencies.d/systemd-udevd-coldplug \
 	image/etc/s6-rc/weston/notification-fd \
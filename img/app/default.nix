@@ -4,7 +4,7 @@
 import ../../lib/call-package.nix (
 { spectrum-app-tools, spectrum-build-tools, src, terminfo
 , lib, appimageTools, buildFHSEnv, runCommand, stdenvNoCC, writeClosure
-, erofs-utils, jq, s6-rc, util-linux, xorg
+, erofs-utils, s6-rc, xorg
 , cacert, linux_latest
 }:
 
@@ -23,8 +23,12 @@ let
 
   kernel = (linux_latest.override {
     structuredExtraConfig = with lib.kernel; {
+      BLK_DEV_PMEM = yes;
+      DAX = yes;
       DRM_FBDEV_EMULATION = lib.mkForce no;
       EROFS_FS = yes;
+      EROFS_FS_ZIP_LZMA = yes;
+      EROFS_FS_ZIP_ZSTD = yes;
       FONTS = lib.mkForce unset;
       FONT_8x8 = lib.mkForce unset;
       FONT_TER16x32 = lib.mkForce unset;
@@ -32,12 +36,17 @@ let
       FRAMEBUFFER_CONSOLE_DEFERRED_TAKEOVER = lib.mkForce unset;
       FRAMEBUFFER_CONSOLE_DETECT_PRIMARY = lib.mkForce unset;
       FRAMEBUFFER_CONSOLE_ROTATION = lib.mkForce unset;
+      FS_DAX = yes;
+      LIBNVDIMM = yes;
       RC_CORE = lib.mkForce unset;
       VIRTIO = yes;
+      VIRTIO_BALLOON = yes;
       VIRTIO_BLK = yes;
       VIRTIO_CONSOLE = yes;
       VIRTIO_PCI = yes;
+      VIRTIO_PMEM = yes;
       VT = no;
+      ZONE_DEVICE = yes;
     };
   }).overrideAttrs ({ installFlags ? [], ... }: {
     installFlags = installFlags ++ [
@@ -105,13 +114,11 @@ stdenvNoCC.mkDerivation {
       ./.
       ../../lib/common.mk
       ../../scripts/make-erofs.sh
-      ../../scripts/make-gpt.sh
-      ../../scripts/sfdisk-field.awk
     ]);
   };
   sourceRoot = "source/img/app";
 
-  nativeBuildInputs = [ erofs-utils jq spectrum-build-tools s6-rc util-linux ];
+  nativeBuildInputs = [ erofs-utils spectrum-build-tools s6-rc ];
 
   env = {
     KERNEL = "${kernel}/${baseNameOf kernelTarget}";
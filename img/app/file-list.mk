@@ -7,7 +7,9 @@ FILES = \
 	image/etc/fstab \
 	image/etc/group \
 	image/etc/mdev.conf \
+	image/etc/mdev/blk \
 	image/etc/mdev/iface \
+	image/etc/mdev/image \
 	image/etc/mdev/listen \
 	image/etc/mdev/virtiofs \
 	image/etc/mdev/wait \
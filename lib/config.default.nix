@@ -4,7 +4,9 @@
 {
   pkgsFun = import ./nixpkgs.default.nix;
   pkgsArgs = {};
+  readaheadProfile = null;
   version = "0.0.0";
   updateUrl = "https://your-spectrum-os-update-server.invalid/download-directory";
   updateSigningKey = ./fake-update-signing-key.gpg;
+  vmPoolSize = 0;
 }
@@ -50,6 +50,10 @@ let
       appSupport = false;
       driverSupport = true;
     };
+    spectrum-initramfs-tools = self.callSpectrumPackage ../tools {
+      appSupport = false;
+      initramfsSupport = true;
+    };
     spectrum-router = self.callSpectrumPackage ../tools/router {};
     xdg-desktop-portal-spectrum-host =
       self.callSpectrumPackage ../tools/xdg-desktop-portal-spectrum-host {};
@@ -14,5 +14,6 @@ import ../../lib/call-package.nix (
     appSupport = true;
     hostSupport = true;
     driverSupport = true;
+    initramfsSupport = true;
   }).tests;
 }) (_: {})
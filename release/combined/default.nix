@@ -4,10 +4,10 @@
 # SPDX-FileCopyrightText: 2022 Unikie
 
 import ../../lib/call-package.nix (
-{ callSpectrumPackage
+{ callSpectrumPackage, spectrum-build-tools
 , lib, runCommand, stdenv, replaceVars, writeClosure
-, dosfstools, grub2_efi, jq, libfaketime, mtools, squashfs-tools-ng
-, systemdMinimal, util-linux
+, dosfstools, grub2_efi, libfaketime, mtools, squashfs-tools-ng
+, systemdMinimal
 }:
 
 let
@@ -90,35 +90,14 @@ let
 in
 
 runCommand "spectrum-installer" {
-  nativeBuildInputs = [ grub jq util-linux systemdMinimal ];
+  nativeBuildInputs = [ grub spectrum-build-tools systemdMinimal ];
   __structuredAttrs = true;
   unsafeDiscardReferences = { out = true; };
   dontFixup = true;
   passthru = { inherit eosimages esp installer rootfs; };
 } ''
-  blockSize() {
-      wc -c "$1" | awk '{printf "%d\n", ($1 + 511) / 512}'
-  }
-
-  fillPartition() {
-      read start size < <(sfdisk -J "$1" | jq -r --argjson index "$2" \
-          '.partitiontable.partitions[$index] | "\(.start) \(.size)"')
-      dd if="$3" of="$1" seek="$start" count="$size" conv=notrunc
-  }
-
-  espSize="$(blockSize ${esp})"
-  installerSize="$(blockSize ${rootfs})"
-  eosimagesSize="$(blockSize ${eosimages})"
-
-  truncate -s $(((3 * 2048 + $espSize + $installerSize + $eosimagesSize) * 512)) $out
-  sfdisk --no-reread --no-tell-kernel $out <<EOF
-  label: gpt
-  size=$espSize, type=U
-  size=$installerSize, type=L, uuid=${installerPartUuid}
-  size=$eosimagesSize, type=56a3bbc3-aefa-43d9-a64d-7b3fd59bbc4e
-  EOF
-
-  fillPartition $out 0 ${esp}
-  fillPartition $out 1 ${rootfs}
-  fillPartition $out 2 ${eosimages}
+  make-gpt $out \
+      ${esp}:c12a7328-f81f-11d2-ba4b-00a0c93ec93b \
+      ${rootfs}:0fc63daf-8483-4772-8e79-3d69d8477de4:${installerPartUuid} \
+      ${eosimages}:56a3bbc3-aefa-43d9-a64d-7b3fd59bbc4e
 '') (_: {})
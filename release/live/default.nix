@@ -6,7 +6,7 @@
 import ../../lib/call-package.nix (
 { callSpectrumPackage, spectrum-build-tools, src
 , lib, pkgsStatic, stdenvNoCC
-, cryptsetup, dosfstools, jq, mtools, util-linux
+, cryptsetup, dosfstools, mtools, util-linux
 , config
 }:
 
@@ -29,14 +29,12 @@ stdenv.mkDerivation {
       ./.
       ../../lib/common.mk
       ../../scripts/format-uuid.sh
-      ../../scripts/make-gpt.sh
-      ../../scripts/sfdisk-field.awk
     ]);
   };
   sourceRoot = "source/release/live";
 
   nativeBuildInputs = [
-    cryptsetup dosfstools jq spectrum-build-tools mtools util-linux
+    cryptsetup dosfstools spectrum-build-tools mtools util-linux
   ];
 
   env = {
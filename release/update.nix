@@ -1,9 +1,10 @@
 # SPDX-License-Identifier: MIT
 # SPDX-FileCopyrightText: 2021-2024 Alyssa Ross <hi@alyssa.is>
 # SPDX-FileCopyrightText: 2025 Demi Marie Obenour <demiobenour@gmail.com>
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
 
 import ../lib/call-package.nix (
-{ callSpectrumPackage, config, runCommand, stdenv }:
+{ callSpectrumPackage, config, spectrum-build-tools, runCommand, stdenv }:
 
 let
   efi = callSpectrumPackage ../host/efi.nix {};
@@ -12,6 +13,7 @@ runCommand "spectrum-update-directory" {
   __structuredAttrs = true;
   unsafeDiscardReferences = { out = true; };
   dontFixup = true;
+  nativeBuildInputs = [ spectrum-build-tools ];
   env = { VERSION = config.version; };
 } ''
   # stdenv sets -eo pipefail, but not -u
@@ -26,8 +28,13 @@ runCommand "spectrum-update-directory" {
   cp -- ${efi} "Spectrum_$VERSION.efi"
   cp -- ${efi.rootfs}/rootfs.verity.superblock "Spectrum_''${VERSION}_''${roothash:32:32}.verity"
   cp -- ${efi.rootfs}/rootfs "Spectrum_''${VERSION}_''${roothash:0:32}.root"
+  # Devices download only the chunks of the root filesystem image
+  # they don't already have, and put it back together themselves.
+  update-chunks index ${efi.rootfs}/rootfs . \
+    > "Spectrum_''${VERSION}_''${roothash:0:32}.root.chunks"
   sha256sum -b "Spectrum_$VERSION.efi" \
     "Spectrum_''${VERSION}_''${roothash:32:32}.verity" \
-    "Spectrum_''${VERSION}_''${roothash:0:32}.root" > SHA256SUMS
+    "Spectrum_''${VERSION}_''${roothash:0:32}.root" \
+    "Spectrum_''${VERSION}_''${roothash:0:32}.root.chunks" > SHA256SUMS
   ''
 ) (_: {})
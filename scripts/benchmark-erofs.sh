@@ -0,0 +1,53 @@
+#!/bin/sh -eu
+#
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
+# SPDX-License-Identifier: EUPL-1.2+
+#
+# Prints the size of each EROFS image given, and how long it takes to
+# read every file in it in a random order through dm-verity, starting
+# with a cold page cache, like when booting from it.  Must be run as
+# root.  See Documentation/doc/development/benchmarking.adoc.
+
+ex_usage() {
+	echo "Usage: benchmark-erofs.sh img..." >&2
+	exit 1
+}
+
+if [ $# -eq 0 ]; then
+	ex_usage
+fi
+
+name="benchmark-erofs-$$"
+dir="$(mktemp -d)"
+trap 'umount -q -- "$dir/mnt" || :; veritysetup close -- "$name" 2>/dev/null || :; rm -rf -- "$dir"' EXIT
+mkdir -- "$dir/mnt"
+
+printf '%-32s %10s %10s %10s\n' IMAGE 'SIZE(MiB)' 'READ(s)' 'MiB/s'
+
+for img; do
+	rm -f -- "$dir/verity"
+	veritysetup format --root-hash-file "$dir/roothash" \
+		-- "$img" "$dir/verity" >/dev/null
+	veritysetup open --root-hash-file "$dir/roothash" \
+		-- "$img" "$name" "$dir/verity"
+	mount -t erofs -o ro -- "/dev/mapper/$name" "$dir/mnt"
+
+	bytes="$(find "$dir/mnt" -type f -printf '%s\n' | awk '{ n += $1 } END { print n + 0 }')"
+	find "$dir/mnt" -type f -print0 | shuf -z >"$dir/files"
+
+	sync
+	echo 3 >/proc/sys/vm/drop_caches
+
+	start="$(date +%s%N)"
+	xargs -0r cat -- <"$dir/files" >/dev/null
+	end="$(date +%s%N)"
+
+	umount -- "$dir/mnt"
+	veritysetup close -- "$name"
+
+	awk -v img="$img" -v size="$(stat -Lc %s -- "$img")" \
+		-v bytes="$bytes" -v ns="$((end - start))" 'BEGIN {
+		s = ns / 1e9
+		printf "%-32s %10.1f %10.2f %10.1f\n", img, size / 1048576, s, bytes / 1048576 / s
+	}'
+done
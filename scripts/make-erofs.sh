@@ -2,82 +2,66 @@
 #
 # SPDX-FileCopyrightText: 2023-2025 Alyssa Ross <hi@alyssa.is>
 # SPDX-FileCopyrightText: 2025 Demi Marie Obenour <demiobenour@gmail.com>
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
 # SPDX-License-Identifier: EUPL-1.2+
 #
-# FIXME: It would be nice to replace this script with a program that
-#        didn't have to redundantly copy everything so it's all in a
-#        single directory structure, and could generate an EROFS image
-#        based on source:dest mappings directly.
+# Makes an EROFS image from source:dest mappings, using srcdest-tar to
+# stream the mapped files to mkfs.erofs without staging a copy of them
+# in a single directory structure.
 
 ex_usage() {
-	echo "Usage: make-erofs.sh [options]... img < srcdest.txt" >&2
+	echo "Usage: make-erofs.sh [--profile=PROFILE] [options]... img < srcdest.txt" >&2
 	exit 1
 }
 
+profile=none
+case "${1-}" in
+--profile=*)
+	profile="${1#--profile=}"
+	shift
+	;;
+esac
+
 for img; do :; done
 if [ -z "${img-}" ]; then
 	ex_usage
 fi
 
-root="$(mktemp -d -- "$img.tmp.XXXXXXXXXX")"
-trap 'chmod -R +w -- "$root" && rm -rf -- "$root"' EXIT
-
-while read -r arg1; do
-	read -r arg2 || ex_usage
-
-	printf "%s" "$arg1" >&2
-	if [ "${arg1#/}" != "${arg2#/}" ]; then
-		printf " -> %s" "$arg2" >&2
-	fi
-	echo >&2
-
-	# The below simple version of dirname(1) can only handle
-	# a subset of all paths, but this subset includes all of
-	# the ones passed in practice other than /.
-	case $arg2 in
-	*/*) parent=${arg2%/*} ;;
-	*) parent=. ;;
-	esac
-
-	# Ensure any existing directories we want to write into are writable.
-	(
-		set --
-		while :; do
-			abs="$root/$parent"
-			if [ -e "$abs" ] && ! [ -w "$abs" ]; then
-				set -- "$abs" "$@"
-			fi
-
-			# shellcheck disable=SC2030 # shadowed on purpose
-			case "$parent" in
-			*/*) parent="${parent%/*}" ;;
-			*) break ;;
-			esac
-		done
-
-		if [ "$#" -ne 0 ]; then
-			chmod +w -- "$@"
-		fi
-	)
-
-	# shellcheck disable=SC2031 # shadowed in subshell on purpose
-	if ! [ -e "$root/$parent" ]; then
-		mkdir -p -- "$root/$parent"
-	fi
-
-	cp -RT -- "$arg1" "$root/$arg2"
-done
-
-# Ensure that the permissions in the image are independent of those in
-# the git repository or Nix store, except for the executable bit.  In
-# particular, the mode of those outside the Nix store might depend on
-# the user's umask.  Paths in the image should not be writable by
-# anyone, but should be world-readable.
-find "$root" \
-	-path "$root/nix/store" -prune -o \
-	-type l -o \
-	-type d -a -perm 0555 -o \
-	-type f -a -perm 0444 -o \
-	-exec chmod a-w,a+rX -- '{}' +
+# Compression profiles trade image size against the CPU time taken to
+# read the image.  Larger physical clusters (-C) compress better, but
+# mean more has to be read and decompressed for each small random
+# read.  Files in compressed images can't be mapped with DAX.
+case "$profile" in
+none) ;;
+lz4hc)
+	set -- -zlz4hc,12 -C65536 -Eztailpacking "$@"
+	;;
+lz4hc-packed)
+	set -- -zlz4hc,12 -C65536 -Eztailpacking,fragments,dedupe "$@"
+	;;
+zstd)
+	set -- -zzstd,15 -C262144 -Eztailpacking,fragments,dedupe "$@"
+	;;
+lzma)
+	set -- -zlzma,9 -C1048576 -Eztailpacking,fragments,dedupe "$@"
+	;;
+*)
+	echo "make-erofs.sh: unknown profile: $profile" >&2
+	ex_usage
+	;;
+esac
 
-mkfs.erofs -x-1 -b4096 --all-root "$@" "$root"
+# mkfs.erofs can't tell a truncated tar stream from a complete one, so
+# srcdest-tar's exit status is passed out of the pipeline on fd 4.
+exec 3>&1
+status="$(
+	{
+		if srcdest-tar 3>&- 4>&-; then
+			echo 0 >&4
+		else
+			echo $? >&4
+		fi |
+			mkfs.erofs -x-1 -b4096 --all-root --tar=f "$@" >&3 4>&-
+	} 4>&1
+)"
+exit "$status"
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Adds the random bytes on stdin to the kernel's entropy pool, and
+// reseeds the kernel's random number generator from it straight away.
+// Writing to /dev/urandom wouldn't do the second part, so a VM
+// restored from a snapshot would go on generating the same numbers as
+// every other VM restored from it until the kernel next reseeded by
+// itself.
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+
+#include <linux/random.h>
+
+// Enough for the kernel to count the pool as fully seeded.
+#define MIN_SEED 32
+#define MAX_SEED 512
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: add-entropy < SEED\n", stderr);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *[])
+{
+	struct rand_pool_info *info;
+	unsigned char *buf;
+	size_t len = 0;
+	ssize_t r;
+	int fd;
+
+	if (argc != 1)
+		ex_usage();
+
+	if (!(info = malloc(sizeof *info + MAX_SEED)))
+		err(EXIT_FAILURE, "malloc");
+	buf = (unsigned char *)info->buf;
+
+	while (len < MAX_SEED) {
+		if ((r = read(STDIN_FILENO, buf + len, MAX_SEED - len)) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "read");
+		}
+		if (!r)
+			break;
+		len += r;
+	}
+	if (len < MIN_SEED)
+		errx(EXIT_FAILURE, "seed is only %zu bytes", len);
+
+	if ((fd = open("/dev/urandom", O_WRONLY | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open /dev/urandom");
+
+	info->entropy_count = len * 8;
+	info->buf_size = len;
+	if (ioctl(fd, RNDADDENTROPY, info) == -1)
+		err(EXIT_FAILURE, "RNDADDENTROPY");
+	if (ioctl(fd, RNDRESEEDCRNG) == -1)
+		err(EXIT_FAILURE, "RNDRESEEDCRNG");
+}
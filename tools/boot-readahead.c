@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Records which parts of which files are in the page cache after a
+// boot, and reads them back in at the start of the next boot, in the
+// order they are laid out on disk, so that booting doesn't have to
+// wait for lots of small random reads through dm-verity.
+//
+// A profile has a line for each range of a file that was cached, with
+// its offset and length in bytes and the file's path.  Because store
+// paths change whenever anything in their closure does, a recorded
+// profile is resolved against the store paths in the image it's going
+// to be used with, matching them by name, before being put in it.
+//
+// Application VM root images are mapped from the host page cache, so
+// recording on the host after starting an application VM also covers
+// the parts of the VM image it read to boot.
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+
+#define STORE "/nix/store/"
+#define HASH_LEN 32
+
+struct range {
+	char *path;
+	off_t off, len;
+	uint64_t physical;
+	size_t n;
+};
+
+struct store_path {
+	const char *path, *name;
+	bool ambiguous;
+};
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: boot-readahead record DIR...\n"
+	      "       boot-readahead resolve [CLOSURE...]\n"
+	      "       boot-readahead replay PROFILE\n",
+	      stderr);
+	exit(EXIT_FAILURE);
+}
+
+static long page_size;
+
+static int record_file(const char *path, const struct stat *st, int type, struct FTW *)
+{
+	size_t pages, start;
+	unsigned char *vec;
+	void *map;
+	int fd;
+
+	if (type != FTW_F || !S_ISREG(st->st_mode) || !st->st_size)
+		return 0;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)) == -1) {
+		warn("open %s", path);
+		return 0;
+	}
+	// Mapping the file doesn't read it, and mincore(2) reports which
+	// of its pages are cached without faulting them in.
+	map = mmap(nullptr, st->st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		warn("mmap %s", path);
+		return 0;
+	}
+
+	pages = (st->st_size + page_size - 1) / page_size;
+	if (!(vec = malloc(pages)))
+		err(EXIT_FAILURE, "malloc");
+	if (mincore(map, st->st_size, vec) == -1)
+		err(EXIT_FAILURE, "mincore %s", path);
+
+	for (size_t i = 0; i < pages; i++) {
+		if (!(vec[i] & 1))
+			continue;
+		for (start = i; i + 1 < pages && vec[i + 1] & 1; i++);
+		if (printf("%jd %jd %s\n", (intmax_t)start * page_size,
+		           (intmax_t)(i + 1 - start) * page_size, path) < 0)
+			err(EXIT_FAILURE, "printf");
+	}
+
+	free(vec);
+	munmap(map, st->st_size);
+	return 0;
+}
+
+static void do_record(int argc, char *argv[])
+{
+	page_size = sysconf(_SC_PAGESIZE);
+
+	for (int i = 0; i < argc; i++)
+		if (nftw(argv[i], record_file, 64, FTW_PHYS | FTW_MOUNT) == -1)
+			err(EXIT_FAILURE, "nftw %s", argv[i]);
+
+	if (fflush(stdout) == EOF)
+		err(EXIT_FAILURE, "fflush");
+}
+
+// Reads a profile line into range, and returns false at the end of
+// the file.  The path is left pointing into line.
+static bool read_range(struct range range[static 1], char **line,
+                       size_t size[static 1], FILE *f, const char name[static 1],
+                       size_t n)
+{
+	intmax_t off, range_len;
+	ssize_t len;
+	int end = 0;
+
+	if ((len = getline(line, size, f)) == -1) {
+		if (ferror(f))
+			err(EXIT_FAILURE, "getline %s", name);
+		return false;
+	}
+	if ((*line)[len - 1] == '\n')
+		(*line)[len - 1] = '\0';
+
+	if (sscanf(*line, "%jd %jd %n", &off, &range_len, &end) != 2 || !end ||
+	    off < 0 || range_len <= 0 || (*line)[end] != '/')
+		errx(EXIT_FAILURE, "%s:%zu: malformed line", name, n);
+	range->off = off;
+	range->len = range_len;
+	range->path = *line + end;
+	return true;
+}
+
+static int compare_name(const void *a, const void *b)
+{
+	return strcmp(((const struct store_path *)a)->name,
+	              ((const struct store_path *)b)->name);
+}
+
+// Returns the part of a store path after the hash, or nullptr if it
+// isn't a store path.
+static const char *store_name(const char path[static 1])
+{
+	if (strncmp(path, STORE, sizeof STORE - 1) ||
+	    strlen(path) < sizeof STORE - 1 + HASH_LEN + 2 ||
+	    path[sizeof STORE - 1 + HASH_LEN] != '-')
+		return nullptr;
+	return path + sizeof STORE - 1 + HASH_LEN + 1;
+}
+
+static void do_resolve(int argc, char *argv[])
+{
+	struct store_path *paths = nullptr, key, *found;
+	size_t len = 0, cap = 0, size = 0, n = 0;
+	char *line = nullptr, *slash;
+	struct range range;
+	ssize_t line_len;
+	FILE *f;
+
+	// Closures can be given in any format with one store path per
+	// line, like the PACKAGES files used to make images.
+	for (int i = 0; i < argc; i++) {
+		if (!(f = fopen(argv[i], "re")))
+			err(EXIT_FAILURE, "fopen %s", argv[i]);
+		while ((line_len = getline(&line, &size, f)) != -1) {
+			if (line[line_len - 1] == '\n')
+				line[line_len - 1] = '\0';
+			if (!(key.name = store_name(line)) || strchr(key.name, '/'))
+				continue;
+			if (len == cap) {
+				cap = cap ? cap * 2 : 1024;
+				if (!(paths = reallocarray(paths, cap, sizeof *paths)))
+					err(EXIT_FAILURE, "reallocarray");
+			}
+			if (!(key.path = strdup(line)))
+				err(EXIT_FAILURE, "strdup");
+			key.name = store_name(key.path);
+			key.ambiguous = false;
+			paths[len++] = key;
+		}
+		if (ferror(f))
+			err(EXIT_FAILURE, "getline %s", argv[i]);
+		fclose(f);
+	}
+
+	qsort(paths, len, sizeof *paths, compare_name);
+	for (size_t i = 1; i < len; i++) {
+		if (strcmp(paths[i - 1].name, paths[i].name))
+			continue;
+		// The same path listed twice is fine, but two different
+		// store paths with the same name can't be told apart.
+		if (strcmp(paths[i - 1].path, paths[i].path))
+			paths[i - 1].ambiguous = paths[i].ambiguous = true;
+	}
+
+	while (read_range(&range, &line, &size, stdin, "stdin", ++n)) {
+		if (!(key.name = store_name(range.path))) {
+			if (printf("%jd %jd %s\n", (intmax_t)range.off,
+			           (intmax_t)range.len, range.path) < 0)
+				err(EXIT_FAILURE, "printf");
+			continue;
+		}
+
+		if ((slash = strchr(key.name, '/')))
+			*slash = '\0';
+		found = len ? bsearch(&key, paths, len, sizeof *paths, compare_name) : nullptr;
+		if (!found || found->ambiguous)
+			continue;
+
+		if (printf("%jd %jd %s%s%s\n", (intmax_t)range.off, (intmax_t)range.len,
+		           found->path, slash ? "/" : "", slash ? slash + 1 : "") < 0)
+			err(EXIT_FAILURE, "printf");
+	}
+
+	if (fflush(stdout) == EOF)
+		err(EXIT_FAILURE, "fflush");
+}
+
+// Finds where on the disk a range of a file starts, so that ranges can
+// be read in disk order.  Ranges that can't be found go last.
+static uint64_t physical(int fd, off_t off, off_t len)
+{
+	union {
+		struct fiemap map;
+		unsigned char buf[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+	} u = {};
+	struct fiemap *map = &u.map;
+	struct fiemap_extent *extent = &map->fm_extents[0];
+
+	map->fm_start = off;
+	map->fm_length = len;
+	map->fm_extent_count = 1;
+	if (ioctl(fd, FS_IOC_FIEMAP, map) == -1 || !map->fm_mapped_extents)
+		return UINT64_MAX;
+	return extent->fe_physical + (off > (off_t)extent->fe_logical ?
+	                              off - extent->fe_logical : 0);
+}
+
+static int compare_physical(const void *a, const void *b)
+{
+	const struct range *ra = a, *rb = b;
+
+	if (ra->physical != rb->physical)
+		return ra->physical < rb->physical ? -1 : 1;
+	return ra->n < rb->n ? -1 : ra->n > rb->n;
+}
+
+static void do_replay(const char profile[static 1])
+{
+	struct range *ranges = nullptr, range;
+	size_t len = 0, cap = 0, size = 0, n = 0;
+	char *line = nullptr;
+	FILE *f;
+	int fd;
+
+	if (!(f = fopen(profile, "re")))
+		err(EXIT_FAILURE, "fopen %s", profile);
+
+	while (read_range(&range, &line, &size, f, profile, ++n)) {
+		// The profile might be for a slightly different image, so
+		// files that have gone are skipped.
+		if ((fd = open(range.path, O_RDONLY | O_CLOEXEC)) == -1)
+			continue;
+		range.physical = physical(fd, range.off, range.len);
+		close(fd);
+
+		if (!(range.path = strdup(range.path)))
+			err(EXIT_FAILURE, "strdup");
+		range.n = len;
+		if (len == cap) {
+			cap = cap ? cap * 2 : 1024;
+			if (!(ranges = reallocarray(ranges, cap, sizeof *ranges)))
+				err(EXIT_FAILURE, "reallocarray");
+		}
+		ranges[len++] = range;
+	}
+	free(line);
+	fclose(f);
+
+	qsort(ranges, len, sizeof *ranges, compare_physical);
+
+	for (size_t i = 0; i < len; i++) {
+		if ((fd = open(ranges[i].path, O_RDONLY | O_CLOEXEC)) == -1)
+			continue;
+		if (readahead(fd, ranges[i].off, ranges[i].len) == -1)
+			warn("readahead %s", ranges[i].path);
+		close(fd);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+		ex_usage();
+
+	if (!strcmp(argv[1], "record") && argc > 2)
+		do_record(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "resolve"))
+		do_resolve(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "replay") && argc == 3)
+		do_replay(argv[2]);
+	else
+		ex_usage();
+}
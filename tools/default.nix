@@ -12,6 +12,7 @@ import ../lib/call-package.nix (
 , appSupport ? true
 , hostSupport ? false
 , driverSupport ? false
+, initramfsSupport ? false
 }:
 
 let
@@ -70,17 +71,32 @@ stdenv.mkDerivation (finalAttrs: {
       ./meson.options
     ] ++ lib.optionals buildSupport [
       ./lseek.c
+      ./make-gpt.c
+      ./srcdest-tar.c
+    ] ++ lib.optionals (buildSupport || hostSupport) [
+      ./boot-readahead.c
+      ./sha256.c
+      ./sha256.h
+      ./update-chunks.c
     ] ++ lib.optionals appSupport [
+      ./add-entropy.c
       ./xdg-desktop-portal-spectrum
     ] ++ lib.optionals hostSupport [
       ./lsvm.rs
       ./sd-notify-adapter.c
       ./start-vmm
       ./subprojects
+      ./timeline.c
       ./updates-dir-check.c
+      ./vm-balloon.rs
+      ./vm-idle.rs
+      ./vm-registry.rs
       ./vm-set-persist.c
+      ./vm-stats.rs
     ] ++ lib.optionals driverSupport [
       ./xdp-forwarder
+    ] ++ lib.optionals initramfsSupport [
+      ./open-rootfs.c
     ]));
   };
   sourceRoot = "source/tools";
@@ -102,6 +118,7 @@ stdenv.mkDerivation (finalAttrs: {
     (lib.mesonBool "app" appSupport)
     (lib.mesonBool "host" hostSupport)
     (lib.mesonBool "driver" driverSupport)
+    (lib.mesonBool "initramfs" initramfsSupport)
     "-Dhostfsrootdir=/host"
     "-Dtests=false"
     "-Dunwind=false"
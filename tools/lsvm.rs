@@ -6,14 +6,17 @@ use std::collections::HashMap;
 use std::env::args_os;
 use std::ffi::{OsStr, OsString};
 use std::fs::read_dir;
-use std::io::{self, Write, stdout};
+use std::io::{self, Read, Write, stdout};
+use std::os::unix::net::UnixStream;
 use std::os::unix::prelude::*;
 use std::path::Path;
-use std::process::{Command, Stdio, exit};
-use std::str;
+use std::process::exit;
+use std::thread;
 
 use miniserde::{Deserialize, json};
 
+use start_vmm::api_request;
+
 fn prog_name() -> String {
     args_os()
         .next()
@@ -36,24 +39,36 @@ fn vm_running(id: &OsStr) -> Result<bool, String> {
         state: String,
     }
 
-    let output = Command::new("ch-remote")
-        .arg("--api-socket")
-        .arg(Path::new("/run/vm/by-id").join(id).join("vmm"))
-        .arg("info")
-        .stderr(Stdio::inherit())
-        .output()
-        .map_err(|e| format!("running ch-remote: {e}"))?;
+    let json = api_request(&Path::new("/run/vm/by-id").join(id), "vm.info", None)?;
+    let Info { state } = json::from_str(&json).map_err(|e| format!("parsing vm.info: {e}"))?;
 
-    if !output.status.success() {
-        return Err("ch-remote failed".to_string());
-    }
+    Ok(state != "Created")
+}
 
-    let json =
-        str::from_utf8(&output.stdout).map_err(|e| format!("parsing ch-remote output: {e}"))?;
-    let Info { state } =
-        json::from_str(json).map_err(|e| format!("parsing ch-remote output: {e}"))?;
+/// Gets the state of every VM from vm-registry in a single request.
+fn registry_states() -> Result<HashMap<OsString, Option<bool>>, String> {
+    let mut stream =
+        UnixStream::connect("/run/vm/registry").map_err(|e| format!("connecting: {e}"))?;
+    let mut buf = vec![];
+    stream
+        .read_to_end(&mut buf)
+        .map_err(|e| format!("reading: {e}"))?;
+
+    let mut states = HashMap::new();
+    for line in buf.split(|&b| b == b'\n').filter(|l| !l.is_empty()) {
+        let space = line
+            .iter()
+            .rposition(|&b| b == b' ')
+            .ok_or_else(|| format!("malformed line {:?}", String::from_utf8_lossy(line)))?;
+        let running = match &line[space + 1..] {
+            b"Running" | b"Paused" => Some(true),
+            b"Created" | b"Shutdown" | b"Stopped" => Some(false),
+            _ => None,
+        };
+        states.insert(OsStr::from_bytes(&line[..space]).to_owned(), running);
+    }
 
-    Ok(state != "Created")
+    Ok(states)
 }
 
 fn write_vm(mut out: impl Write, vm: &Vm) -> io::Result<()> {
@@ -110,13 +125,41 @@ fn run() -> Result<(), String> {
 
     writeln!(stdout, "ID     STATUS  NAMES").map_err(|e| format!("writing output: {e}"))?;
 
-    for (id, names) in names {
-        let running = vm_running(&id)
-            .inspect_err(|e| eprintln!("{}: getting state of {:?}: {e}", prog_name(), id))
-            .ok();
-
-        let vm = Vm { running, id, names };
+    let vms: Vec<_> = match registry_states() {
+        Ok(mut states) => names
+            .into_iter()
+            .map(|(id, names)| {
+                let running = states.remove(&id).flatten();
+                Vm { running, id, names }
+            })
+            .collect(),
+
+        // If vm-registry isn't available, ask each VMM, all at once
+        // so that unresponsive VMMs don't add up.
+        Err(e) => {
+            eprintln!("{}: querying vm-registry: {e}", prog_name());
+
+            thread::scope(|s| {
+                let handles: Vec<_> = names
+                    .into_iter()
+                    .map(|(id, names)| {
+                        s.spawn(move || {
+                            let running = vm_running(&id)
+                                .inspect_err(|e| {
+                                    eprintln!("{}: getting state of {:?}: {e}", prog_name(), id)
+                                })
+                                .ok();
+                            Vm { running, id, names }
+                        })
+                    })
+                    .collect();
+
+                handles.into_iter().map(|h| h.join().unwrap()).collect()
+            })
+        }
+    };
 
+    for vm in vms {
         write_vm(&mut stdout, &vm).map_err(|e| format!("writing output: {e}"))?;
     }
 
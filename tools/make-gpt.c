@@ -0,0 +1,439 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Writes a GPT disk image containing the given files as partitions.
+//
+// Partitions are 1MiB aligned, and as large as their contents rounded
+// up to a whole number of MiB unless a size is given, with 1MiB free
+// at the start and end of the disk for the partition tables.  The
+// contents are copied with reflinks or copy_file_range(2) where the
+// filesystem supports it, and holes in them are preserved, so images
+// are sparse.
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include <linux/fs.h>
+
+#define SECTOR 512
+#define MiB 1048576
+#define ENTRIES 128
+#define ENTRY_SIZE 128
+#define ENTRIES_SECTORS (ENTRIES * ENTRY_SIZE / SECTOR)
+
+struct part {
+	const char *path;
+	unsigned char type[16], uuid[16];
+	uint16_t name[36];
+	uint64_t start, mib;
+};
+
+struct type_alias {
+	const char *name, *arch, *guid;
+};
+
+static const struct type_alias type_aliases[] = {
+	{ "root", "aarch64", "b921b045-1df0-41c3-af44-4c6f280d3fae" },
+	{ "root", "x86_64", "4f68bce3-e8cd-4db1-96e7-fbcaf984b709" },
+	{ "verity", "aarch64", "df3300ce-d69f-4c92-978c-9bfb0f38d820" },
+	{ "verity", "x86_64", "2c7357ed-ebd2-46d9-aec1-23d437ec2bf5" },
+};
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: make-gpt GPT_PATH PATH:PARTTYPE[:PARTUUID[:PARTLABEL[:PARTMiB]]]...\n",
+	      stderr);
+	exit(EXIT_FAILURE);
+}
+
+static uint32_t crc32(const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	uint32_t crc = 0xffffffff;
+
+	while (len--) {
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++)
+			crc = crc >> 1 ^ (0xedb88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static void put_le16(unsigned char *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put_le32(unsigned char *p, uint32_t v)
+{
+	put_le16(p, v);
+	put_le16(p + 2, v >> 16);
+}
+
+static void put_le64(unsigned char *p, uint64_t v)
+{
+	put_le32(p, v);
+	put_le32(p + 4, v >> 32);
+}
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Parses a GUID in its usual textual form into its on-disk form, in
+// which the first three fields are little endian.
+static bool parse_guid(unsigned char out[static 16], const char s[static 1])
+{
+	static const int order[16] = {
+		3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15,
+	};
+	unsigned char bytes[16];
+	int n = 0;
+
+	if (strlen(s) != 36)
+		return false;
+
+	for (const char *p = s; *p; p += 2) {
+		int hi, lo;
+
+		if (*p == '-' && (n == 4 || n == 6 || n == 8 || n == 10))
+			p++;
+		if (n == 16 || (hi = hex_digit(p[0])) == -1 ||
+		    (lo = hex_digit(p[1])) == -1)
+			return false;
+		bytes[n++] = hi << 4 | lo;
+	}
+	if (n != 16)
+		return false;
+
+	for (int i = 0; i < 16; i++)
+		out[i] = bytes[order[i]];
+	return true;
+}
+
+static void random_guid(unsigned char out[static 16])
+{
+	if (getrandom(out, 16, 0) != 16)
+		err(EXIT_FAILURE, "getrandom");
+
+	// Version 4 (random), variant 1.  The version is in the high bits
+	// of the third field, which is stored little endian.
+	out[7] = (out[7] & 0x0f) | 0x40;
+	out[8] = (out[8] & 0x3f) | 0x80;
+}
+
+static const char *arch(void)
+{
+	static struct utsname u;
+	const char *env = getenv("ARCH");
+
+	if (env && *env)
+		return env;
+	if (uname(&u) == -1)
+		err(EXIT_FAILURE, "uname");
+	return u.machine;
+}
+
+static void parse_type(unsigned char out[static 16], const char type[static 1])
+{
+	for (size_t i = 0; i < sizeof type_aliases / sizeof *type_aliases; i++)
+		if (!strcmp(type_aliases[i].name, type) &&
+		    !strcmp(type_aliases[i].arch, arch()))
+			type = type_aliases[i].guid;
+
+	if (!parse_guid(out, type))
+		errx(EXIT_FAILURE, "invalid partition type: %s", type);
+}
+
+// Converts a UTF-8 partition label to the UTF-16LE form stored in
+// partition entries.
+static void parse_name(uint16_t out[static 36], const char name[static 1])
+{
+	const unsigned char *p = (const unsigned char *)name;
+	size_t n = 0;
+
+	while (*p) {
+		uint32_t c;
+		int len;
+
+		if (*p < 0x80)
+			c = *p, len = 0;
+		else if ((*p & 0xe0) == 0xc0)
+			c = *p & 0x1f, len = 1;
+		else if ((*p & 0xf0) == 0xe0)
+			c = *p & 0x0f, len = 2;
+		else if ((*p & 0xf8) == 0xf0)
+			c = *p & 0x07, len = 3;
+		else
+			errx(EXIT_FAILURE, "invalid UTF-8 in partition label: %s", name);
+		for (p++; len--; p++) {
+			if ((*p & 0xc0) != 0x80)
+				errx(EXIT_FAILURE, "invalid UTF-8 in partition label: %s", name);
+			c = c << 6 | (*p & 0x3f);
+		}
+
+		if (c >= 0x10000) {
+			if (n + 2 > 36)
+				goto too_long;
+			c -= 0x10000;
+			out[n++] = 0xd800 | c >> 10;
+			out[n++] = 0xdc00 | (c & 0x3ff);
+		} else {
+			if (n + 1 > 36)
+				goto too_long;
+			out[n++] = c;
+		}
+	}
+	return;
+
+too_long:
+	errx(EXIT_FAILURE, "partition label too long: %s", name);
+}
+
+static uint64_t content_mib(const char path[static 1])
+{
+	struct stat st;
+
+	if (stat(path, &st) == -1)
+		err(EXIT_FAILURE, "stat %s", path);
+	return ((uint64_t)st.st_size + MiB - 1) / MiB;
+}
+
+static void parse_part(struct part part[static 1], char arg[static 1])
+{
+	char *fields[5] = {}, *p = arg;
+	size_t n = 0;
+	uint64_t mib;
+
+	while (p && n < sizeof fields / sizeof *fields)
+		fields[n++] = strsep(&p, ":");
+	if (p || n < 2 || !*fields[0])
+		ex_usage();
+
+	part->path = fields[0];
+	parse_type(part->type, fields[1]);
+
+	if (fields[2] && *fields[2]) {
+		if (!parse_guid(part->uuid, fields[2]))
+			errx(EXIT_FAILURE, "invalid partition UUID: %s", fields[2]);
+	} else {
+		random_guid(part->uuid);
+	}
+
+	if (fields[3])
+		parse_name(part->name, fields[3]);
+
+	part->mib = content_mib(part->path);
+	if (fields[4] && *fields[4]) {
+		errno = 0;
+		mib = strtoull(fields[4], &p, 10);
+		if (errno || p == fields[4] || *p)
+			errx(EXIT_FAILURE, "invalid partition size: %s", fields[4]);
+		if (mib < part->mib)
+			errx(EXIT_FAILURE,
+			     "%ju MiB partition content is too big for %ju MiB partition",
+			     (uintmax_t)part->mib, (uintmax_t)mib);
+		part->mib = mib;
+	}
+	if (!part->mib)
+		errx(EXIT_FAILURE, "%s: partition would be empty", part->path);
+}
+
+static void pwrite_all(int fd, const void *buf, size_t len, off_t off)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	while (len) {
+		if ((r = pwrite(fd, p, len, off)) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "pwrite");
+		}
+		p += r;
+		off += r;
+		len -= r;
+	}
+}
+
+// Copies len bytes at off in one file to dest_off in another, without
+// writing blocks that are entirely zero, since the destination starts
+// out sparse.
+static void copy_range(int in, int out, off_t off, off_t dest_off, off_t len)
+{
+	static const char zeros[1 << 16];
+	static char buf[1 << 16];
+	ssize_t r;
+
+	while (len) {
+		r = copy_file_range(in, &off, out, &dest_off, len, 0);
+		if (r > 0) {
+			len -= r;
+			continue;
+		}
+		if (!r)
+			errx(EXIT_FAILURE, "unexpected end of file");
+		if (errno == EINTR)
+			continue;
+		if (errno != EXDEV && errno != EINVAL && errno != ENOSYS &&
+		    errno != EOPNOTSUPP)
+			err(EXIT_FAILURE, "copy_file_range");
+
+		// Not supported between these files, so copy by hand.
+		while (len) {
+			r = pread(in, buf, len < (off_t)sizeof buf ? len : (off_t)sizeof buf, off);
+			if (r == -1) {
+				if (errno == EINTR)
+					continue;
+				err(EXIT_FAILURE, "pread");
+			}
+			if (!r)
+				errx(EXIT_FAILURE, "unexpected end of file");
+			if (memcmp(buf, zeros, r))
+				pwrite_all(out, buf, r, dest_off);
+			off += r;
+			dest_off += r;
+			len -= r;
+		}
+	}
+}
+
+static void fill_part(int out, const struct part part[static 1])
+{
+	struct file_clone_range clone;
+	off_t data, hole = 0, dest = part->start * SECTOR;
+	struct stat st;
+	int in;
+
+	if ((in = open(part->path, O_RDONLY | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", part->path);
+	if (fstat(in, &st) == -1)
+		err(EXIT_FAILURE, "fstat %s", part->path);
+	if (!st.st_size)
+		goto out;
+
+	// Share the whole file's extents if the filesystem supports it.
+	// This fails if the file's size isn't a multiple of the block
+	// size, but copy_file_range(2) can still share all but the last
+	// block.
+	clone = (struct file_clone_range){ .src_fd = in, .dest_offset = dest };
+	if (!ioctl(out, FICLONERANGE, &clone))
+		goto out;
+
+	while ((data = lseek(in, hole, SEEK_DATA)) != -1) {
+		if ((hole = lseek(in, data, SEEK_HOLE)) == -1)
+			err(EXIT_FAILURE, "lseek %s", part->path);
+		copy_range(in, out, data, dest + data, hole - data);
+	}
+	if (errno != ENXIO)
+		err(EXIT_FAILURE, "lseek %s", part->path);
+
+out:
+	close(in);
+}
+
+static void write_header(int fd, const unsigned char disk_guid[static 16],
+                         uint64_t lba, uint64_t alt_lba, uint64_t entries_lba,
+                         uint64_t last_lba, uint32_t entries_crc)
+{
+	unsigned char h[SECTOR] = {};
+
+	memcpy(h, "EFI PART", 8);
+	put_le32(h + 8, 0x00010000);
+	put_le32(h + 12, 92);
+	put_le64(h + 24, lba);
+	put_le64(h + 32, alt_lba);
+	put_le64(h + 40, 2 + ENTRIES_SECTORS);
+	put_le64(h + 48, last_lba - 1 - ENTRIES_SECTORS);
+	memcpy(h + 56, disk_guid, 16);
+	put_le64(h + 72, entries_lba);
+	put_le32(h + 80, ENTRIES);
+	put_le32(h + 84, ENTRY_SIZE);
+	put_le32(h + 88, entries_crc);
+	put_le32(h + 16, crc32(h, 92));
+
+	pwrite_all(fd, h, sizeof h, lba * SECTOR);
+}
+
+int main(int argc, char *argv[])
+{
+	static unsigned char entries[ENTRIES][ENTRY_SIZE];
+	unsigned char mbr[SECTOR] = {}, disk_guid[16];
+	uint64_t sectors, next = MiB / SECTOR;
+	uint32_t entries_crc;
+	struct part *parts;
+	int fd, n = argc - 2;
+
+	if (argc < 3 || n > ENTRIES)
+		ex_usage();
+
+	if (!(parts = calloc(n, sizeof *parts)))
+		err(EXIT_FAILURE, "calloc");
+
+	for (int i = 0; i < n; i++) {
+		unsigned char *e = entries[i];
+
+		parse_part(&parts[i], argv[i + 2]);
+		parts[i].start = next;
+		next += parts[i].mib * (MiB / SECTOR);
+
+		memcpy(e, parts[i].type, 16);
+		memcpy(e + 16, parts[i].uuid, 16);
+		put_le64(e + 32, parts[i].start);
+		put_le64(e + 40, next - 1);
+		for (int j = 0; j < 36; j++)
+			put_le16(e + 56 + j * 2, parts[i].name[j]);
+	}
+	sectors = next + MiB / SECTOR;
+	random_guid(disk_guid);
+	entries_crc = crc32(entries, sizeof entries);
+
+	if ((fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) == -1)
+		err(EXIT_FAILURE, "open %s", argv[1]);
+	if (ftruncate(fd, sectors * SECTOR) == -1)
+		err(EXIT_FAILURE, "ftruncate %s", argv[1]);
+
+	// Protective MBR, covering the whole disk, or as much of it as an
+	// MBR can.
+	mbr[446 + 2] = 0x02;
+	mbr[446 + 4] = 0xee;
+	memset(mbr + 446 + 5, 0xff, 3);
+	put_le32(mbr + 446 + 8, 1);
+	put_le32(mbr + 446 + 12, sectors - 1 > UINT32_MAX ? UINT32_MAX : sectors - 1);
+	mbr[510] = 0x55;
+	mbr[511] = 0xaa;
+	pwrite_all(fd, mbr, sizeof mbr, 0);
+
+	pwrite_all(fd, entries, sizeof entries, 2 * SECTOR);
+	write_header(fd, disk_guid, 1, sectors - 1, 2, sectors - 1, entries_crc);
+	pwrite_all(fd, entries, sizeof entries,
+	           (sectors - 1 - ENTRIES_SECTORS) * SECTOR);
+	write_header(fd, disk_guid, sectors - 1, 1, sectors - 1 - ENTRIES_SECTORS,
+	             sectors - 1, entries_crc);
+
+	for (int i = 0; i < n; i++)
+		fill_part(fd, &parts[i]);
+
+	if (close(fd) == -1)
+		err(EXIT_FAILURE, "close %s", argv[1]);
+}
@@ -0,0 +1,514 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Finds the root filesystem and verity partitions, whose partition
+// UUIDs are the two halves of the root hash, and opens them as a
+// dm-verity device as soon as both have appeared.
+//
+// Partitions are found by listening for uevents, and looking at the
+// block devices that already exist in case they appeared first.  The
+// GPT of each disk is only read once.  Progress is printed with the
+// time since boot, so it's possible to see where boot time goes.
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <linux/dm-ioctl.h>
+#include <linux/fs.h>
+#include <linux/netlink.h>
+
+#define MAX_ENTRIES 1024
+#define WAIT_MESSAGE_MS 5000
+
+struct disk {
+	char *name;
+	unsigned char (*guids)[16];
+	uint32_t len;
+};
+
+struct part {
+	const char *what;
+	unsigned char guid[16];
+	char name[NAME_MAX + 1], dev[32];
+	bool found;
+};
+
+static struct disk *disks;
+static size_t disks_len;
+
+static struct part parts[] = {
+	{ .what = "root filesystem" },
+	{ .what = "verity" },
+};
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: open-rootfs ROOTHASH NAME\n", stderr);
+	exit(EXIT_FAILURE);
+}
+
+[[gnu::format(printf, 1, 2)]]
+static void timeline(const char *fmt, ...)
+{
+	struct timespec ts;
+	va_list ap;
+
+	clock_gettime(CLOCK_BOOTTIME, &ts);
+	fprintf(stderr, "[%5jd.%06ld] open-rootfs: ", (intmax_t)ts.tv_sec,
+	        ts.tv_nsec / 1000);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+// Turns 32 hex digits, as used for a partition UUID, into the on-disk
+// form of the GUID, in which the first three fields are little endian.
+static bool parse_guid(unsigned char out[static 16], const char hex[static 32])
+{
+	static const int order[16] = {
+		3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15,
+	};
+	int hi, lo;
+
+	for (int i = 0; i < 16; i++) {
+		if ((hi = hex_digit(hex[order[i] * 2])) == -1 ||
+		    (lo = hex_digit(hex[order[i] * 2 + 1])) == -1)
+			return false;
+		out[i] = hi << 4 | lo;
+	}
+	return true;
+}
+
+static uint32_t get_le32(const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_le64(const unsigned char *p)
+{
+	return get_le32(p) | (uint64_t)get_le32(p + 4) << 32;
+}
+
+// Reads the partition GUIDs from a disk's GPT.  Disks that can't be
+// read or don't have a GPT are remembered as having no partitions.
+static void read_gpt(struct disk disk[static 1])
+{
+	unsigned char header[512], *entries = nullptr;
+	uint32_t entry_size;
+	uint64_t entries_lba;
+	char path[PATH_MAX];
+	int fd, sector_size;
+
+	disk->guids = nullptr;
+	disk->len = 0;
+
+	snprintf(path, sizeof path, "/dev/%s", disk->name);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		warn("open %s", path);
+		return;
+	}
+
+	if (ioctl(fd, BLKSSZGET, &sector_size) == -1 ||
+	    sector_size < (int)sizeof header ||
+	    pread(fd, header, sizeof header, sector_size) != sizeof header ||
+	    memcmp(header, "EFI PART", 8))
+		goto out;
+
+	entries_lba = get_le64(header + 72);
+	disk->len = get_le32(header + 80);
+	entry_size = get_le32(header + 84);
+	if (disk->len > MAX_ENTRIES)
+		disk->len = MAX_ENTRIES;
+	if (entry_size < 128 || entry_size % 8 || !disk->len)
+		goto fail;
+
+	if (!(entries = malloc((size_t)disk->len * entry_size)) ||
+	    !(disk->guids = calloc(disk->len, sizeof *disk->guids)))
+		err(EXIT_FAILURE, "malloc");
+	if (pread(fd, entries, (size_t)disk->len * entry_size,
+	          entries_lba * sector_size) != (ssize_t)((size_t)disk->len * entry_size))
+		goto fail;
+
+	for (uint32_t i = 0; i < disk->len; i++)
+		memcpy(disk->guids[i], entries + (size_t)i * entry_size + 16, 16);
+	timeline("read GPT of %s", disk->name);
+	goto out;
+
+fail:
+	warnx("can't read GPT of %s", path);
+	free(disk->guids);
+	disk->guids = nullptr;
+	disk->len = 0;
+out:
+	free(entries);
+	close(fd);
+}
+
+static struct disk *get_disk(const char name[static 1])
+{
+	struct disk *disk;
+
+	for (size_t i = 0; i < disks_len; i++)
+		if (!strcmp(disks[i].name, name))
+			return &disks[i];
+
+	if (!(disks = reallocarray(disks, disks_len + 1, sizeof *disks)))
+		err(EXIT_FAILURE, "reallocarray");
+	disk = &disks[disks_len++];
+	if (!(disk->name = strdup(name)))
+		err(EXIT_FAILURE, "strdup");
+	read_gpt(disk);
+	return disk;
+}
+
+// Forgets the GPT of a disk, because its partitions have changed.
+static void forget_disk(const char name[static 1])
+{
+	for (size_t i = 0; i < disks_len; i++) {
+		if (strcmp(disks[i].name, name))
+			continue;
+		free(disks[i].name);
+		free(disks[i].guids);
+		disks[i] = disks[--disks_len];
+		return;
+	}
+}
+
+static void add_partition(const char name[static 1], const char disk_name[static 1],
+                          unsigned long partn, const char dev[static 1])
+{
+	struct disk *disk = nullptr;
+
+	for (size_t i = 0; i < sizeof parts / sizeof *parts; i++) {
+		if (parts[i].found)
+			continue;
+		if (!disk)
+			disk = get_disk(disk_name);
+		if (!partn || partn > disk->len ||
+		    memcmp(disk->guids[partn - 1], parts[i].guid, 16))
+			continue;
+
+		if (snprintf(parts[i].name, sizeof parts[i].name, "%s", name) >=
+		    (int)sizeof parts[i].name ||
+		    snprintf(parts[i].dev, sizeof parts[i].dev, "%s", dev) >=
+		    (int)sizeof parts[i].dev)
+			errx(EXIT_FAILURE, "device name of %s too long", name);
+		parts[i].found = true;
+		timeline("found %s partition %s", parts[i].what, name);
+	}
+}
+
+static bool read_sysfs(char *buf, size_t size, const char *fmt, const char *name)
+{
+	char path[PATH_MAX];
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof path, fmt, name);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return false;
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len <= 0)
+		return false;
+	buf[len - (buf[len - 1] == '\n')] = '\0';
+	return true;
+}
+
+// Looks at the partitions that already exist.
+static void scan(void)
+{
+	char partn[32], dev[32], path[PATH_MAX], link[PATH_MAX], *slash;
+	struct dirent *entry;
+	ssize_t len;
+	DIR *dir;
+
+	if (!(dir = opendir("/sys/class/block")))
+		err(EXIT_FAILURE, "opendir /sys/class/block");
+
+	while ((errno = 0, entry = readdir(dir))) {
+		if (entry->d_name[0] == '.' ||
+		    !read_sysfs(partn, sizeof partn, "/sys/class/block/%s/partition", entry->d_name) ||
+		    !read_sysfs(dev, sizeof dev, "/sys/class/block/%s/dev", entry->d_name))
+			continue;
+
+		// The parent of a partition in sysfs is its disk.
+		snprintf(path, sizeof path, "/sys/class/block/%s", entry->d_name);
+		if ((len = readlink(path, link, sizeof link - 1)) == -1)
+			err(EXIT_FAILURE, "readlink %s", path);
+		link[len] = '\0';
+		if (!(slash = strrchr(link, '/')))
+			continue;
+		*slash = '\0';
+		if (!(slash = strrchr(link, '/')))
+			continue;
+
+		add_partition(entry->d_name, slash + 1, strtoul(partn, nullptr, 10), dev);
+	}
+	if (errno)
+		err(EXIT_FAILURE, "readdir /sys/class/block");
+
+	closedir(dir);
+}
+
+static void handle_uevent(char *buf, size_t len)
+{
+	const char *action = nullptr, *subsystem = nullptr, *devpath = nullptr,
+	           *devtype = nullptr, *devname = nullptr, *major = nullptr,
+	           *minor = nullptr, *partn = nullptr;
+	char dev[32], parent[PATH_MAX], *slash;
+
+	for (char *p = buf; p < buf + len; p += strlen(p) + 1) {
+		if (!strncmp(p, "ACTION=", 7))
+			action = p + 7;
+		else if (!strncmp(p, "SUBSYSTEM=", 10))
+			subsystem = p + 10;
+		else if (!strncmp(p, "DEVPATH=", 8))
+			devpath = p + 8;
+		else if (!strncmp(p, "DEVTYPE=", 8))
+			devtype = p + 8;
+		else if (!strncmp(p, "DEVNAME=", 8))
+			devname = p + 8;
+		else if (!strncmp(p, "MAJOR=", 6))
+			major = p + 6;
+		else if (!strncmp(p, "MINOR=", 6))
+			minor = p + 6;
+		else if (!strncmp(p, "PARTN=", 6))
+			partn = p + 6;
+	}
+
+	if (!action || !subsystem || !devpath || !devtype ||
+	    strcmp(subsystem, "block"))
+		return;
+
+	// A disk changing means its partition table might have been
+	// rewritten.
+	if (!strcmp(devtype, "disk")) {
+		if (!strcmp(action, "change") && (slash = strrchr(devpath, '/')))
+			forget_disk(slash + 1);
+		return;
+	}
+
+	if (strcmp(devtype, "partition") || !devname || !major || !minor || !partn ||
+	    (strcmp(action, "add") && strcmp(action, "change")))
+		return;
+
+	snprintf(parent, sizeof parent, "%s", devpath);
+	if (!(slash = strrchr(parent, '/')))
+		return;
+	*slash = '\0';
+	if (!(slash = strrchr(parent, '/')))
+		return;
+	snprintf(dev, sizeof dev, "%s:%s", major, minor);
+	add_partition(devname, slash + 1, strtoul(partn, nullptr, 10), dev);
+}
+
+static bool all_found(void)
+{
+	for (size_t i = 0; i < sizeof parts / sizeof *parts; i++)
+		if (!parts[i].found)
+			return false;
+	return true;
+}
+
+static void wait_for_partitions(void)
+{
+	struct sockaddr_nl addr = { .nl_family = AF_NETLINK, .nl_groups = 1 };
+	static char buf[8192];
+	int fd, size = 1 << 20;
+	bool waited = false;
+	ssize_t len;
+
+	if ((fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+	                 NETLINK_KOBJECT_UEVENT)) == -1)
+		err(EXIT_FAILURE, "socket");
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof size);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof addr) == -1)
+		err(EXIT_FAILURE, "bind");
+
+	// Partitions that appeared before the socket was listening won't
+	// have uevents.
+	scan();
+
+	while (!all_found()) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		switch (poll(&pfd, 1, waited ? -1 : WAIT_MESSAGE_MS)) {
+		case -1:
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "poll");
+		case 0:
+			for (size_t i = 0; i < sizeof parts / sizeof *parts; i++)
+				if (!parts[i].found)
+					timeline("still waiting for %s partition", parts[i].what);
+			waited = true;
+			continue;
+		}
+
+		struct sockaddr_nl src;
+		socklen_t src_len = sizeof src;
+
+		if ((len = recvfrom(fd, buf, sizeof buf - 1, MSG_DONTWAIT,
+		                    (struct sockaddr *)&src, &src_len)) == -1) {
+			// If uevents were missed, look at what's there now.
+			if (errno == ENOBUFS)
+				scan();
+			else if (errno != EAGAIN && errno != EINTR)
+				err(EXIT_FAILURE, "recv");
+			continue;
+		}
+		// Only trust uevents from the kernel, not from other
+		// processes sending to the multicast group.
+		if (src_len != sizeof src || src.nl_pid)
+			continue;
+		buf[len] = '\0';
+		handle_uevent(buf, len);
+	}
+
+	close(fd);
+}
+
+static void dm_init(struct dm_ioctl io[static 1], size_t size, const char name[static 1])
+{
+	memset(io, 0, size);
+	io->version[0] = DM_VERSION_MAJOR;
+	io->data_size = size;
+	io->data_start = sizeof *io;
+	if (snprintf(io->name, sizeof io->name, "%s", name) >= (int)sizeof io->name)
+		errx(EXIT_FAILURE, "device name %s too long", name);
+}
+
+static bool valid_block_size(uint32_t size)
+{
+	return size >= 512 && size <= 4096 && !(size & (size - 1));
+}
+
+// Opens the partitions as a dm-verity device, using the parameters in
+// the verity superblock, which is in the format written by veritysetup.
+static void open_verity(const char roothash[static 65], const char name[static 1])
+{
+	struct {
+		struct dm_ioctl io;
+		struct dm_target_spec spec;
+		char params[1024];
+	} table;
+	struct dm_ioctl io;
+	unsigned char sb[512];
+	uint32_t hash_type, data_block_size, hash_block_size;
+	uint64_t data_blocks;
+	uint16_t salt_size;
+	char path[PATH_MAX], salt[513] = "-", algorithm[33] = {};
+	int fd, control;
+
+	snprintf(path, sizeof path, "/dev/%s", parts[1].name);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", path);
+	if (pread(fd, sb, sizeof sb, 0) != sizeof sb)
+		err(EXIT_FAILURE, "reading verity superblock from %s", path);
+	close(fd);
+
+	if (memcmp(sb, "verity\0\0", 8) || get_le32(sb + 8) != 1)
+		errx(EXIT_FAILURE, "%s doesn't have a verity superblock", path);
+	hash_type = get_le32(sb + 12);
+	// The superblock isn't authenticated, so anything that ends up in
+	// the table has to be checked, or it could add table arguments.
+	if (!memchr(sb + 32, '\0', 32))
+		errx(EXIT_FAILURE, "bad verity hash algorithm on %s", path);
+	memcpy(algorithm, sb + 32, 32);
+	if (!*algorithm ||
+	    algorithm[strspn(algorithm, "abcdefghijklmnopqrstuvwxyz0123456789-")])
+		errx(EXIT_FAILURE, "bad verity hash algorithm on %s", path);
+	data_block_size = get_le32(sb + 64);
+	hash_block_size = get_le32(sb + 68);
+	data_blocks = get_le64(sb + 72);
+	salt_size = sb[80] | sb[81] << 8;
+	if (hash_type > 1 || salt_size > 256 ||
+	    !valid_block_size(data_block_size) ||
+	    !valid_block_size(hash_block_size))
+		errx(EXIT_FAILURE, "bad verity superblock on %s", path);
+	for (int i = 0; i < salt_size; i++)
+		snprintf(salt + i * 2, 3, "%02x", sb[88 + i]);
+
+	if ((control = open("/dev/mapper/control", O_RDWR | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open /dev/mapper/control");
+
+	dm_init(&io, sizeof io, name);
+	if (ioctl(control, DM_DEV_CREATE, &io) == -1)
+		err(EXIT_FAILURE, "creating %s", name);
+
+	dm_init(&table.io, sizeof table, name);
+	table.io.target_count = 1;
+	table.io.flags = DM_READONLY_FLAG;
+	table.spec = (struct dm_target_spec){
+		.length = data_blocks * (data_block_size / 512),
+	};
+	strcpy(table.spec.target_type, "verity");
+	// The hash tree starts in the first hash block after the
+	// superblock.
+	if (snprintf(table.params, sizeof table.params,
+	             "%" PRIu32 " %s %s %" PRIu32 " %" PRIu32 " %" PRIu64 " 1 %s %s %s",
+	             hash_type, parts[0].dev, parts[1].dev, data_block_size,
+	             hash_block_size, data_blocks, algorithm, roothash, salt) >=
+	    (int)sizeof table.params)
+		errx(EXIT_FAILURE, "verity table too long");
+
+	if (ioctl(control, DM_TABLE_LOAD, &table) == -1) {
+		warn("loading table for %s", name);
+		dm_init(&io, sizeof io, name);
+		ioctl(control, DM_DEV_REMOVE, &io);
+		exit(EXIT_FAILURE);
+	}
+
+	dm_init(&io, sizeof io, name);
+	if (ioctl(control, DM_DEV_SUSPEND, &io) == -1)
+		err(EXIT_FAILURE, "resuming %s", name);
+	close(control);
+
+	snprintf(path, sizeof path, "/dev/mapper/%s", name);
+	if (mknod(path, S_IFBLK | 0600, io.dev) == -1 && errno != EEXIST)
+		err(EXIT_FAILURE, "mknod %s", path);
+	timeline("opened %s", path);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+		ex_usage();
+
+	if (strlen(argv[1]) != 64 || !parse_guid(parts[0].guid, argv[1]) ||
+	    !parse_guid(parts[1].guid, argv[1] + 32))
+		errx(EXIT_FAILURE, "roothash invalid or missing");
+
+	timeline("waiting for partitions");
+	wait_for_partitions();
+	open_verity(argv[1], argv[2]);
+}
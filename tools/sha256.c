@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+// SHA-256, as specified in FIPS 180-4.
+
+#include "sha256.h"
+
+#include <string.h>
+
+#ifdef __x86_64__
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t ror(uint32_t x, int n)
+{
+	return x >> n | x << (32 - n);
+}
+
+static void block(uint32_t state[static 8], const unsigned char p[static 64])
+{
+	uint32_t w[64], s[8], t1, t2;
+
+	for (int i = 0; i < 16; i++)
+		w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+		       (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+	for (int i = 16; i < 64; i++)
+		w[i] = w[i - 16] + w[i - 7] +
+		       (ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ w[i - 15] >> 3) +
+		       (ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ w[i - 2] >> 10);
+
+	memcpy(s, state, sizeof s);
+	for (int i = 0; i < 64; i++) {
+		t1 = s[7] + (ror(s[4], 6) ^ ror(s[4], 11) ^ ror(s[4], 25)) +
+		     ((s[4] & s[5]) ^ (~s[4] & s[6])) + k[i] + w[i];
+		t2 = (ror(s[0], 2) ^ ror(s[0], 13) ^ ror(s[0], 22)) +
+		     ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+		s[7] = s[6];
+		s[6] = s[5];
+		s[5] = s[4];
+		s[4] = s[3] + t1;
+		s[3] = s[2];
+		s[2] = s[1];
+		s[1] = s[0];
+		s[0] = t1 + t2;
+	}
+	for (int i = 0; i < 8; i++)
+		state[i] += s[i];
+}
+
+static void blocks_generic(uint32_t state[static 8], const unsigned char *p, size_t n)
+{
+	for (; n; n--, p += 64)
+		block(state, p);
+}
+
+#ifdef __x86_64__
+// The SHA extensions keep the state as ABEF and CDGH, and do two
+// rounds per instruction, with the message schedule computed four
+// words at a time.
+[[gnu::target("sha,sse4.1")]]
+static void blocks_shani(uint32_t state[static 8], const unsigned char *p, size_t n)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+	__m128i abef, cdgh, abef_save, cdgh_save, tmp, msg, w[4];
+
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+	for (; n; n--, p += 64) {
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		for (int i = 0; i < 4; i++)
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + i * 16)),
+			                        bswap);
+
+		for (int i = 0; i < 16; i++) {
+			msg = _mm_add_epi32(w[i % 4],
+			                    _mm_loadu_si128((const __m128i *)&k[i * 4]));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh,
+			                             _mm_shuffle_epi32(msg, 0x0e));
+
+			if (i < 12) {
+				tmp = _mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(i + 3) % 4],
+				                                         w[(i + 2) % 4], 4));
+				w[i % 4] = _mm_sha256msg2_epu32(tmp, w[(i + 3) % 4]);
+			}
+		}
+
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+	}
+
+	tmp = _mm_shuffle_epi32(abef, 0x1b);
+	cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, cdgh, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+static bool have_shani(void)
+{
+	unsigned int a, b, c, d;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1))
+		return false;
+	return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_SHA);
+}
+#endif
+
+static void (*blocks)(uint32_t state[static 8], const unsigned char *p, size_t n) =
+	blocks_generic;
+
+#ifdef __x86_64__
+[[gnu::constructor]] static void choose_blocks(void)
+{
+	if (have_shani())
+		blocks = blocks_shani;
+}
+#endif
+
+void sha256_init(struct sha256 ctx[static 1])
+{
+	static const uint32_t init[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(ctx->state, init, sizeof init);
+	ctx->len = 0;
+}
+
+void sha256_update(struct sha256 ctx[static 1], const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	size_t used = ctx->len % 64, n;
+
+	ctx->len += len;
+
+	if (used) {
+		n = len < 64 - used ? len : 64 - used;
+		memcpy(ctx->buf + used, p, n);
+		p += n;
+		len -= n;
+		if (used + n < 64)
+			return;
+		blocks(ctx->state, ctx->buf, 1);
+	}
+
+	blocks(ctx->state, p, len / 64);
+	p += len / 64 * 64;
+	memcpy(ctx->buf, p, len % 64);
+}
+
+void sha256_final(struct sha256 ctx[static 1], unsigned char digest[static 32])
+{
+	size_t used = ctx->len % 64;
+	uint64_t bits = ctx->len * 8;
+
+	ctx->buf[used++] = 0x80;
+	if (used > 56) {
+		memset(ctx->buf + used, 0, 64 - used);
+		blocks(ctx->state, ctx->buf, 1);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, 56 - used);
+	for (int i = 0; i < 8; i++)
+		ctx->buf[56 + i] = bits >> (56 - i * 8);
+	blocks(ctx->state, ctx->buf, 1);
+
+	for (int i = 0; i < 32; i++)
+		digest[i] = ctx->state[i / 4] >> (24 - i % 4 * 8);
+}
+
+void sha256_hex(const unsigned char digest[static 32], char hex[static 65])
+{
+	static const char digits[] = "0123456789abcdef";
+
+	for (int i = 0; i < 32; i++) {
+		hex[i * 2] = digits[digest[i] >> 4];
+		hex[i * 2 + 1] = digits[digest[i] & 0xf];
+	}
+	hex[64] = '\0';
+}
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct sha256 {
+	uint32_t state[8];
+	uint64_t len;
+	unsigned char buf[64];
+};
+
+void sha256_init(struct sha256 ctx[static 1]);
+void sha256_update(struct sha256 ctx[static 1], const void *data, size_t len);
+void sha256_final(struct sha256 ctx[static 1], unsigned char digest[static 32]);
+
+// Formats a digest as 64 lowercase hex digits and a NUL.
+void sha256_hex(const unsigned char digest[static 32], char hex[static 65]);
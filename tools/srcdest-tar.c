@@ -0,0 +1,416 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Reads pairs of lines naming a source path and the path it should
+// have in a filesystem image, and writes a tar stream of them to
+// stdout for mkfs.erofs --tar, so that images can be made without
+// first copying everything into a single directory structure.
+//
+// Permissions are made independent of those in the git repository or
+// Nix store, except for the executable bit: outside the Nix store,
+// nothing is writable, and everything is world-readable.  Entries are
+// written in a fixed order, so the same input always produces the
+// same image.
+
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <search.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+struct header {
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+};
+
+static_assert(sizeof(struct header) == 512);
+
+// Directories already written, so parents of later paths aren't
+// written again with different metadata.
+static void *dirs;
+
+// Entries aren't given mtimes later than this, if it's set.
+static long long source_date_epoch = -1;
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: srcdest-tar < srcdest.txt\n", stderr);
+	exit(EXIT_FAILURE);
+}
+
+static void write_all(const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	while (len) {
+		if ((r = write(STDOUT_FILENO, p, len)) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "write");
+		}
+		p += r;
+		len -= r;
+	}
+}
+
+static void pad(uintmax_t size)
+{
+	static const char zeros[512];
+
+	if (size % 512)
+		write_all(zeros, 512 - size % 512);
+}
+
+// Writes value as a NUL-terminated octal number filling field, and
+// returns whether it fit.
+static bool octal(char *field, size_t len, uintmax_t value)
+{
+	field[len - 1] = '\0';
+	for (size_t i = len - 1; i-- > 0; value >>= 3)
+		field[i] = '0' + (value & 7);
+	return !value;
+}
+
+static size_t decimal_digits(size_t n)
+{
+	size_t digits = 1;
+	while (n /= 10)
+		digits++;
+	return digits;
+}
+
+// Appends a pax extended header record, which is prefixed by its own
+// length in decimal.
+static void pax_record(FILE *f, const char key[static 1],
+                       const char value[static 1])
+{
+	size_t n = strlen(key) + strlen(value) + 3, len = n + decimal_digits(n);
+
+	while (len != n + decimal_digits(len))
+		len = n + decimal_digits(len);
+
+	if (fprintf(f, "%zu %s=%s\n", len, key, value) < 0)
+		err(EXIT_FAILURE, "fprintf");
+}
+
+static void checksum(struct header h[static 1])
+{
+	const unsigned char *p = (const unsigned char *)h;
+	unsigned sum = 0;
+
+	memset(h->chksum, ' ', sizeof h->chksum);
+	for (size_t i = 0; i < sizeof *h; i++)
+		sum += p[i];
+	octal(h->chksum, sizeof h->chksum - 1, sum);
+}
+
+static void write_header(const char path[static 1], const struct stat st[static 1],
+                         char type, uintmax_t size, const char *link)
+{
+	struct header h = {}, xh = {};
+	long long mtime = st->st_mtime;
+	char *pax = nullptr, num[32];
+	size_t len, pax_len = 0;
+	FILE *pax_f;
+
+	if (!(pax_f = open_memstream(&pax, &pax_len)))
+		err(EXIT_FAILURE, "open_memstream");
+
+	if (source_date_epoch != -1 && mtime > source_date_epoch)
+		mtime = source_date_epoch;
+	if (mtime < 0)
+		mtime = 0;
+
+	// Names that don't fit are truncated, and given in full in the pax
+	// header, which takes precedence.
+	if ((len = strlen(path)) >= sizeof h.name) {
+		pax_record(pax_f, "path", path);
+		len = sizeof h.name;
+	}
+	memcpy(h.name, path, len);
+	if (link) {
+		if ((len = strlen(link)) >= sizeof h.linkname) {
+			pax_record(pax_f, "linkpath", link);
+			len = sizeof h.linkname;
+		}
+		memcpy(h.linkname, link, len);
+	}
+	if (!octal(h.size, sizeof h.size, size)) {
+		snprintf(num, sizeof num, "%ju", size);
+		pax_record(pax_f, "size", num);
+		octal(h.size, sizeof h.size, 0);
+	}
+
+	octal(h.mode, sizeof h.mode, st->st_mode & 07777);
+	octal(h.uid, sizeof h.uid, 0);
+	octal(h.gid, sizeof h.gid, 0);
+	octal(h.mtime, sizeof h.mtime, mtime);
+	h.typeflag = type;
+	memcpy(h.magic, "ustar", sizeof h.magic);
+	memcpy(h.version, "00", sizeof h.version);
+	if (type == '3' || type == '4') {
+		if (!octal(h.devmajor, sizeof h.devmajor, major(st->st_rdev)) ||
+		    !octal(h.devminor, sizeof h.devminor, minor(st->st_rdev)))
+			errx(EXIT_FAILURE, "%s: device number too large", path);
+	}
+
+	if (fclose(pax_f) == EOF)
+		err(EXIT_FAILURE, "fclose");
+
+	if (pax_len) {
+		memcpy(xh.name, "PaxHeader", sizeof "PaxHeader");
+		octal(xh.mode, sizeof xh.mode, 0644);
+		octal(xh.uid, sizeof xh.uid, 0);
+		octal(xh.gid, sizeof xh.gid, 0);
+		octal(xh.size, sizeof xh.size, pax_len);
+		octal(xh.mtime, sizeof xh.mtime, mtime);
+		xh.typeflag = 'x';
+		memcpy(xh.magic, "ustar", sizeof xh.magic);
+		memcpy(xh.version, "00", sizeof xh.version);
+		checksum(&xh);
+		write_all(&xh, sizeof xh);
+		write_all(pax, pax_len);
+		pad(pax_len);
+	}
+	free(pax);
+
+	checksum(&h);
+	write_all(&h, sizeof h);
+}
+
+static bool in_store(const char dest[static 1])
+{
+	return !strcmp(dest, "nix/store") || !strncmp(dest, "nix/store/", 10);
+}
+
+// The equivalent of chmod a-w,a+rX, outside the Nix store, where
+// permissions are already normalized.
+static mode_t normalize_mode(const char dest[static 1], mode_t mode)
+{
+	if (S_ISLNK(mode) || in_store(dest))
+		return mode;
+
+	mode = (mode & ~(mode_t)0222) | 0444;
+	if (S_ISDIR(mode) || mode & 0111)
+		mode |= 0111;
+	return mode;
+}
+
+static int strcmp_void(const void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+static bool seen_dir(const char dest[static 1])
+{
+	char *copy, **node;
+
+	if (!(copy = strdup(dest)))
+		err(EXIT_FAILURE, "strdup");
+	if (!(node = tsearch(copy, &dirs, strcmp_void)))
+		err(EXIT_FAILURE, "tsearch");
+	if (*node != copy) {
+		free(copy);
+		return true;
+	}
+	return false;
+}
+
+static void write_parents(char dest[static 1])
+{
+	struct stat st = {
+		.st_mtime = source_date_epoch == -1 ? 0 : source_date_epoch,
+	};
+	char *slash = dest;
+
+	while ((slash = strchr(slash, '/'))) {
+		*slash = '\0';
+		if (!seen_dir(dest)) {
+			st.st_mode = normalize_mode(dest, S_IFDIR | 0755);
+			write_header(dest, &st, '5', 0, nullptr);
+		}
+		*slash++ = '/';
+	}
+}
+
+static void write_file(const char src[static 1], const char dest[static 1],
+                       const struct stat st[static 1])
+{
+	static char buf[1 << 16];
+	uintmax_t total = 0;
+	ssize_t r;
+	int fd;
+
+	if ((fd = open(src, O_RDONLY | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", src);
+
+	write_header(dest, st, '0', st->st_size, nullptr);
+
+	while ((r = read(fd, buf, sizeof buf))) {
+		if (r == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "read %s", src);
+		}
+		if (total + r > (uintmax_t)st->st_size)
+			break;
+		write_all(buf, r);
+		total += r;
+	}
+	if (total != (uintmax_t)st->st_size)
+		errx(EXIT_FAILURE, "%s changed size while being read", src);
+	pad(total);
+
+	close(fd);
+}
+
+static int compare(const struct dirent **a, const struct dirent **b)
+{
+	return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+static int not_dots(const struct dirent *d)
+{
+	return strcmp(d->d_name, ".") && strcmp(d->d_name, "..");
+}
+
+static char *join(const char dir[static 1], const char name[static 1])
+{
+	char *path;
+
+	if (asprintf(&path, "%s%s%s", dir, *dir ? "/" : "", name) == -1)
+		err(EXIT_FAILURE, "asprintf");
+	return path;
+}
+
+// Writes src, and everything under it if it's a directory, to dest.
+// An empty dest is the root of the image, which isn't written itself.
+static void add(const char src[static 1], const char dest[static 1])
+{
+	struct dirent **entries;
+	struct stat st;
+	char *link;
+	ssize_t r;
+	int n;
+
+	if (lstat(src, &st) == -1)
+		err(EXIT_FAILURE, "lstat %s", src);
+	st.st_mode = normalize_mode(dest, st.st_mode);
+
+	if (!*dest && !S_ISDIR(st.st_mode))
+		errx(EXIT_FAILURE, "%s: only a directory can be the image root", src);
+
+	switch (st.st_mode & S_IFMT) {
+	case S_IFREG:
+		write_file(src, dest, &st);
+		break;
+	case S_IFDIR:
+		if (*dest) {
+			seen_dir(dest);
+			write_header(dest, &st, '5', 0, nullptr);
+		}
+
+		if ((n = scandir(src, &entries, not_dots, compare)) == -1)
+			err(EXIT_FAILURE, "scandir %s", src);
+		for (int i = 0; i < n; i++) {
+			char *child_src = join(src, entries[i]->d_name);
+			char *child_dest = join(dest, entries[i]->d_name);
+			add(child_src, child_dest);
+			free(child_src);
+			free(child_dest);
+			free(entries[i]);
+		}
+		free(entries);
+		break;
+	case S_IFLNK:
+		if (!(link = malloc(st.st_size + 1)))
+			err(EXIT_FAILURE, "malloc");
+		if ((r = readlink(src, link, st.st_size + 1)) == -1)
+			err(EXIT_FAILURE, "readlink %s", src);
+		if (r > st.st_size)
+			errx(EXIT_FAILURE, "%s changed while being read", src);
+		link[r] = '\0';
+		write_header(dest, &st, '2', 0, link);
+		free(link);
+		break;
+	case S_IFCHR:
+		write_header(dest, &st, '3', 0, nullptr);
+		break;
+	case S_IFBLK:
+		write_header(dest, &st, '4', 0, nullptr);
+		break;
+	case S_IFIFO:
+		write_header(dest, &st, '6', 0, nullptr);
+		break;
+	default:
+		errx(EXIT_FAILURE, "%s: unsupported file type", src);
+	}
+}
+
+int main(int argc, char *[])
+{
+	static const char end[1024];
+	char *src = nullptr, *dest = nullptr, *p, *env;
+	size_t src_size = 0, dest_size = 0;
+	ssize_t len;
+
+	if (argc > 1)
+		ex_usage();
+
+	if ((env = getenv("SOURCE_DATE_EPOCH"))) {
+		errno = 0;
+		source_date_epoch = strtoll(env, &p, 10);
+		if (errno || p == env || *p || source_date_epoch < 0)
+			errx(EXIT_FAILURE, "invalid SOURCE_DATE_EPOCH: %s", env);
+	}
+
+	while ((len = getline(&src, &src_size, stdin)) != -1) {
+		if (len && src[len - 1] == '\n')
+			src[len - 1] = '\0';
+
+		if ((len = getline(&dest, &dest_size, stdin)) == -1)
+			ex_usage();
+		if (len && dest[len - 1] == '\n')
+			dest[len - 1] = '\0';
+
+		fputs(src, stderr);
+		if (strcmp(src + strspn(src, "/"), dest + strspn(dest, "/")))
+			fprintf(stderr, " -> %s", dest);
+		fputc('\n', stderr);
+
+		p = dest + strspn(dest, "/");
+		for (len = strlen(p); len && p[len - 1] == '/'; len--)
+			p[len - 1] = '\0';
+		write_parents(p);
+		add(src, p);
+	}
+	if (ferror(stdin))
+		err(EXIT_FAILURE, "getline");
+
+	write_all(end, sizeof end);
+}
@@ -2,17 +2,23 @@
 // SPDX-FileCopyrightText: 2022-2024 Alyssa Ross <hi@alyssa.is>
 // SPDX-FileCopyrightText: 2025 Yureka Lilian <yureka@cyberchaos.dev>
 
-use std::ffi::OsStr;
 use std::fs::File;
-use std::io::Write;
-use std::os::unix::prelude::*;
+use std::io::{BufRead, BufReader, Read, Write};
+use std::os::unix::net::UnixStream;
 use std::path::Path;
-use std::process::{Command, Stdio};
 
 use miniserde::{Serialize, json};
 
 use crate::net::MacAddress;
 use crate::s6::notify_readiness;
+use crate::trace::Span;
+
+#[derive(Serialize)]
+pub struct BalloonConfig {
+    pub size: u64,
+    pub deflate_on_oom: bool,
+    pub free_page_reporting: bool,
+}
 
 #[derive(Serialize)]
 pub struct ConsoleConfig {
@@ -20,16 +26,42 @@ pub struct ConsoleConfig {
     pub file: Option<String>,
 }
 
+#[derive(Serialize)]
+pub struct CpuAffinity {
+    pub vcpu: u8,
+    pub host_cpus: Vec<usize>,
+}
+
+#[derive(Serialize)]
+pub struct CpuTopology {
+    pub threads_per_core: u8,
+    pub cores_per_die: u8,
+    pub dies_per_package: u8,
+    pub packages: u8,
+}
+
+#[derive(Serialize)]
+pub struct CpusConfig {
+    pub boot_vcpus: u8,
+    pub max_vcpus: u8,
+    pub topology: Option<CpuTopology>,
+    pub affinity: Option<Vec<CpuAffinity>>,
+}
+
 #[derive(Serialize)]
 pub struct DiskConfig {
     pub path: String,
     pub readonly: bool,
     pub disable_io_uring: bool,
     pub disable_aio: bool,
+    pub num_queues: usize,
+    pub queue_size: u16,
+    pub serial: String,
 }
 
 #[derive(Serialize)]
 pub struct FsConfig {
+    pub queue_size: u16,
     pub socket: String,
     pub tag: &'static str,
 }
@@ -49,14 +81,24 @@ pub struct NetConfig {
 
 #[derive(Serialize)]
 pub struct MemoryConfig {
-    pub size: i64,
+    pub size: u64,
     pub shared: bool,
+    pub hugepages: bool,
+    pub hugepage_size: Option<u64>,
+    pub prefault: bool,
+    pub thp: bool,
 }
 
 #[derive(Serialize)]
 pub struct PayloadConfig {
     pub kernel: String,
-    pub cmdline: &'static str,
+    pub cmdline: String,
+}
+
+#[derive(Serialize)]
+pub struct PmemConfig {
+    pub file: String,
+    pub discard_writes: bool,
 }
 
 #[derive(Serialize)]
@@ -67,58 +109,170 @@ pub struct VsockConfig {
 
 #[derive(Serialize)]
 pub struct LandlockConfig {
-    pub path: &'static str,
+    pub path: String,
     pub access: &'static str,
 }
 
 #[derive(Serialize)]
 pub struct VmConfig {
+    pub balloon: Option<BalloonConfig>,
     pub console: ConsoleConfig,
+    pub cpus: CpusConfig,
     pub disks: Vec<DiskConfig>,
-    pub fs: [FsConfig; 1],
-    pub gpu: [GpuConfig; 1],
+    pub fs: Vec<FsConfig>,
+    pub gpu: Vec<GpuConfig>,
     pub memory: MemoryConfig,
     pub net: Vec<NetConfig>,
     pub payload: PayloadConfig,
+    pub pmem: Vec<PmemConfig>,
     pub serial: ConsoleConfig,
     pub vsock: VsockConfig,
     pub landlock_enable: bool,
-    pub landlock_rules: [LandlockConfig; 2],
+    pub landlock_rules: Vec<LandlockConfig>,
 }
 
-fn command(vm_dir: &Path, s: impl AsRef<OsStr>) -> Command {
-    let mut command = Command::new("ch-remote");
-    command.stdin(Stdio::null());
-    command.arg("--api-socket");
-    command.arg(vm_dir.join("vmm"));
-    command.arg(s);
-    command
+#[derive(Serialize)]
+struct RestoreConfig {
+    source_url: String,
+    prefault: bool,
 }
 
-pub fn create_vm(vm_dir: &Path, ready_fd: File, config: VmConfig) -> Result<(), String> {
-    let mut ch_remote = command(vm_dir, "create")
-        .args(["--", "-"])
-        .stdin(Stdio::piped())
-        .spawn()
-        .map_err(|e| format!("failed to start ch-remote: {e}"))?;
-
-    let json = json::to_string(&config);
-    write!(ch_remote.stdin.as_ref().unwrap(), "{json}")
-        .map_err(|e| format!("writing to ch-remote's stdin: {e}"))?;
-
-    let status = ch_remote
-        .wait()
-        .map_err(|e| format!("waiting for ch-remote: {e}"))?;
-    if !status.success() {
-        if let Some(code) = status.code() {
-            return Err(format!("ch-remote exited {code}"));
-        } else {
-            let signal = status.signal().unwrap();
-            return Err(format!("ch-remote killed by signal {signal}"));
+/// Cloud Hypervisor's API endpoints that are queried with GET.  Every
+/// other endpoint takes a PUT.
+const GET_ENDPOINTS: [&str; 3] = ["vm.counters", "vm.info", "vmm.ping"];
+
+fn read_response(stream: impl Read) -> Result<String, String> {
+    let mut reader = BufReader::new(stream);
+    let mut line = String::new();
+
+    reader
+        .read_line(&mut line)
+        .map_err(|e| format!("reading response status: {e}"))?;
+    let status = line
+        .split(' ')
+        .nth(1)
+        .and_then(|s| s.parse::<u16>().ok())
+        .ok_or_else(|| format!("malformed response status line: {line:?}"))?;
+
+    // Cloud Hypervisor keeps the connection open after responding, so
+    // the body can't be read until EOF.  Responses without a body
+    // don't have a Content-Length header.
+    let mut content_length = 0;
+    loop {
+        line.clear();
+        reader
+            .read_line(&mut line)
+            .map_err(|e| format!("reading response headers: {e}"))?;
+        let header = line.trim_end_matches(['\r', '\n']);
+        if header.is_empty() {
+            break;
+        }
+
+        if let Some(value) = header
+            .split_once(':')
+            .filter(|(name, _)| name.eq_ignore_ascii_case("content-length"))
+            .map(|(_, value)| value.trim())
+        {
+            content_length = value
+                .parse()
+                .map_err(|e| format!("parsing Content-Length {value:?}: {e}"))?;
         }
     }
 
+    let mut body = vec![0; content_length];
+    reader
+        .read_exact(&mut body)
+        .map_err(|e| format!("reading response body: {e}"))?;
+    let body = String::from_utf8(body).map_err(|e| format!("parsing response body: {e}"))?;
+
+    if !(200..300).contains(&status) {
+        return Err(format!("VMM responded {status}: {body}"));
+    }
+
+    Ok(body)
+}
+
+/// Makes a request to a Cloud Hypervisor API endpoint (e.g. "vm.boot"),
+/// returning the body of the response.
+pub fn api_request(vm_dir: &Path, endpoint: &str, body: Option<&str>) -> Result<String, String> {
+    let socket_path = vm_dir.join("vmm");
+    let mut stream = UnixStream::connect(&socket_path)
+        .map_err(|e| format!("connecting to {socket_path:?}: {e}"))?;
+
+    let method = if GET_ENDPOINTS.contains(&endpoint) {
+        "GET"
+    } else {
+        "PUT"
+    };
+
+    let mut request =
+        format!("{method} /api/v1/{endpoint} HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n");
+    if let Some(body) = body {
+        request.push_str("Content-Type: application/json\r\n");
+        request.push_str(&format!("Content-Length: {}\r\n\r\n", body.len()));
+        request.push_str(body);
+    } else {
+        request.push_str("\r\n");
+    }
+
+    stream
+        .write_all(request.as_bytes())
+        .map_err(|e| format!("sending {endpoint} request: {e}"))?;
+
+    read_response(&stream).map_err(|e| format!("{endpoint}: {e}"))
+}
+
+pub fn create_vm(vm_dir: &Path, ready_fd: File, config: VmConfig) -> Result<(), String> {
+    let span = Span::begin(vm_dir, "vm.create");
+    api_request(vm_dir, "vm.create", Some(&json::to_string(&config)))?;
+    drop(span);
+
     notify_readiness(ready_fd)?;
 
     Ok(())
 }
+
+/// Restores a VM from a snapshot taken with vm.snapshot.  The restored
+/// VM is left paused.
+pub fn restore_vm(vm_dir: &Path, ready_fd: File, snapshot: &str) -> Result<(), String> {
+    let config = RestoreConfig {
+        source_url: format!("file://{snapshot}"),
+        // Only the memory the guest actually touches should be read
+        // in, or restoring would take as long as booting.
+        prefault: false,
+    };
+    let span = Span::begin(vm_dir, "vm.restore");
+    api_request(vm_dir, "vm.restore", Some(&json::to_string(&config)))?;
+    drop(span);
+
+    notify_readiness(ready_fd)?;
+
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn response_no_content() {
+        let response = b"HTTP/1.1 204 No Content\r\nServer: Cloud Hypervisor API\r\n\r\n";
+        assert_eq!(read_response(&response[..]).unwrap(), "");
+    }
+
+    #[test]
+    fn response_body() {
+        let response = b"HTTP/1.1 200 OK\r\ncontent-length: 19\r\n\r\n{\"state\":\"Created\"}";
+        assert_eq!(
+            read_response(&response[..]).unwrap(),
+            "{\"state\":\"Created\"}"
+        );
+    }
+
+    #[test]
+    fn response_error() {
+        let response = b"HTTP/1.1 500 Internal Server Error\r\nContent-Length: 6\r\n\r\nfailed";
+        let e = read_response(&response[..]).unwrap_err();
+        assert_eq!(e, "VMM responded 500: failed");
+    }
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+//! Optional settings in a VM's configuration directory.  Each setting
+//! is a file containing a single value, optionally followed by a
+//! newline.
+
+use std::fs::read_to_string;
+use std::io::ErrorKind;
+use std::path::Path;
+
+/// Returns the contents of the setting file at path, or None if it
+/// doesn't exist.
+pub fn read_setting(path: &Path) -> Result<Option<String>, String> {
+    match read_to_string(path) {
+        Ok(mut value) => {
+            if value.ends_with('\n') {
+                value.pop();
+            }
+            Ok(Some(value))
+        }
+        Err(e) if e.kind() == ErrorKind::NotFound => Ok(None),
+        Err(e) => Err(format!("reading {path:?}: {e}")),
+    }
+}
+
+/// Reads a setting that is either "on" or "off".
+pub fn read_on_off(path: &Path) -> Result<Option<bool>, String> {
+    match read_setting(path)?.as_deref() {
+        None => Ok(None),
+        Some("on") => Ok(Some(true)),
+        Some("off") => Ok(Some(false)),
+        Some(value) => Err(format!("{path:?} must be \"on\" or \"off\", not {value:?}")),
+    }
+}
+
+/// Reads a size in bytes, optionally with a K, M, or G suffix.
+pub fn read_size(path: &Path) -> Result<Option<u64>, String> {
+    let Some(value) = read_setting(path)? else {
+        return Ok(None);
+    };
+
+    let (digits, shift) = match value.as_bytes().last() {
+        Some(b'K') => (&value[..value.len() - 1], 10),
+        Some(b'M') => (&value[..value.len() - 1], 20),
+        Some(b'G') => (&value[..value.len() - 1], 30),
+        _ => (&value[..], 0),
+    };
+
+    digits
+        .parse::<u64>()
+        .ok()
+        .and_then(|n| n.checked_mul(1 << shift))
+        .filter(|&n| n != 0)
+        .map(Some)
+        .ok_or_else(|| format!("{path:?} is not a valid size: {value:?}"))
+}
+
+/// Parses a list of CPUs in the kernel's format, e.g. "0-3,8".
+pub fn parse_cpu_list(list: &str) -> Option<Vec<usize>> {
+    let mut cpus = vec![];
+
+    for range in list.split(',') {
+        let (first, last): (usize, usize) = match range.split_once('-') {
+            Some((first, last)) => (first.parse().ok()?, last.parse().ok()?),
+            None => {
+                let cpu = range.parse().ok()?;
+                (cpu, cpu)
+            }
+        };
+        if first > last {
+            return None;
+        }
+        cpus.extend(first..=last);
+    }
+
+    cpus.sort_unstable();
+    cpus.dedup();
+    Some(cpus)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{remove_file, write};
+
+    fn with_setting<T>(value: &str, f: impl FnOnce(&Path) -> T) -> T {
+        let path = std::env::temp_dir().join(format!(
+            "spectrum-start-vmm-config-test.{}.{value}",
+            std::process::id()
+        ));
+        write(&path, value).unwrap();
+        let result = f(&path);
+        remove_file(&path).unwrap();
+        result
+    }
+
+    #[test]
+    fn size_suffixes() {
+        assert_eq!(with_setting("4096\n", read_size), Ok(Some(4096)));
+        assert_eq!(with_setting("2M", read_size), Ok(Some(2 << 20)));
+        assert_eq!(with_setting("4G\n", read_size), Ok(Some(4 << 30)));
+    }
+
+    #[test]
+    fn size_invalid() {
+        assert!(with_setting("0", read_size).is_err());
+        assert!(with_setting("1T", read_size).is_err());
+        assert!(with_setting("", read_size).is_err());
+    }
+
+    #[test]
+    fn on_off() {
+        assert_eq!(with_setting("on\n", read_on_off), Ok(Some(true)));
+        assert_eq!(with_setting("off", read_on_off), Ok(Some(false)));
+        assert!(with_setting("yes", read_on_off).is_err());
+    }
+
+    #[test]
+    fn cpu_list() {
+        assert_eq!(parse_cpu_list("0"), Some(vec![0]));
+        assert_eq!(parse_cpu_list("0-3,8"), Some(vec![0, 1, 2, 3, 8]));
+        assert_eq!(parse_cpu_list("4-5,1,4"), Some(vec![1, 4, 5]));
+        assert_eq!(parse_cpu_list(""), None);
+        assert_eq!(parse_cpu_list("3-1"), None);
+        assert_eq!(parse_cpu_list("0,a"), None);
+    }
+
+    #[test]
+    fn missing() {
+        let path = Path::new("/nonexistent/spectrum/setting");
+        assert_eq!(read_setting(path), Ok(None));
+        assert_eq!(read_size(path), Ok(None));
+    }
+}
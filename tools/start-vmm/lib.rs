@@ -3,8 +3,10 @@
 // SPDX-FileCopyrightText: 2025 Yureka Lilian <yureka@cyberchaos.dev>
 
 mod ch;
+mod config;
 mod net;
 mod s6;
+mod trace;
 
 use std::borrow::Cow;
 use std::env::args_os;
@@ -12,13 +14,17 @@ use std::ffi::OsStr;
 use std::fs::File;
 use std::hash::{Hash, Hasher};
 use std::io::ErrorKind;
-use std::path::Path;
+use std::path::{Path, PathBuf};
 
 use ch::{
-    ConsoleConfig, DiskConfig, FsConfig, GpuConfig, LandlockConfig, MemoryConfig, NetConfig,
-    PayloadConfig, VmConfig, VsockConfig,
+    BalloonConfig, ConsoleConfig, CpuAffinity, CpuTopology, CpusConfig, DiskConfig, FsConfig,
+    GpuConfig, LandlockConfig, MemoryConfig, NetConfig, PayloadConfig, PmemConfig, VmConfig,
+    VsockConfig,
 };
 use net::MacAddress;
+use trace::Span;
+
+pub use ch::api_request;
 
 pub fn prog_name() -> String {
     args_os()
@@ -30,6 +36,229 @@ pub fn prog_name() -> String {
         .into_owned()
 }
 
+/// Returns the CPUs local to the devices that will be passed through
+/// to VMs, i.e. those bound to vfio-pci.
+fn passthrough_device_cpus() -> Result<Vec<usize>, String> {
+    let dir = Path::new("/sys/bus/pci/drivers/vfio-pci");
+    let mut cpus = vec![];
+
+    let entries = match dir.read_dir() {
+        Ok(entries) => entries,
+        // vfio-pci isn't loaded, so there are no passthrough devices.
+        Err(e) if e.kind() == ErrorKind::NotFound => return Ok(cpus),
+        Err(e) => return Err(format!("reading {dir:?}: {e}")),
+    };
+
+    for entry in entries {
+        let path = entry
+            .map_err(|e| format!("examining directory entry: {e}"))?
+            .path()
+            .join("local_cpulist");
+        // Only device directories have a local_cpulist.
+        let Some(list) = config::read_setting(&path)? else {
+            continue;
+        };
+        cpus.extend(
+            config::parse_cpu_list(&list).ok_or_else(|| format!("{path:?}: invalid {list:?}"))?,
+        );
+    }
+
+    cpus.sort_unstable();
+    cpus.dedup();
+    Ok(cpus)
+}
+
+fn cpus_config(dir: &Path) -> Result<CpusConfig, String> {
+    fn read_count(path: &Path) -> Result<Option<u8>, String> {
+        config::read_setting(path)?
+            .map(|n| {
+                n.parse()
+                    .ok()
+                    .filter(|&n| n != 0)
+                    .ok_or_else(|| format!("{path:?}: invalid vCPU count {n:?}"))
+            })
+            .transpose()
+    }
+
+    let boot_vcpus = read_count(&dir.join("boot"))?.unwrap_or(1);
+    let max_vcpus = read_count(&dir.join("max"))?.unwrap_or(boot_vcpus);
+
+    if max_vcpus < boot_vcpus {
+        return Err(format!("{dir:?}: max is less than boot"));
+    }
+
+    let topology = config::read_setting(&dir.join("topology"))?
+        .map(|topology| {
+            let parts = topology
+                .split(':')
+                .map(|n| n.parse().ok().filter(|&n| n != 0))
+                .collect::<Option<Vec<u8>>>();
+
+            match parts.as_deref() {
+                Some(&[threads_per_core, cores_per_die, dies_per_package, packages]) => {
+                    Ok(CpuTopology {
+                        threads_per_core,
+                        cores_per_die,
+                        dies_per_package,
+                        packages,
+                    })
+                }
+                _ => Err(format!(
+                    "{dir:?}: topology must be THREADS:CORES:DIES:PACKAGES, not {topology:?}"
+                )),
+            }
+        })
+        .transpose()?;
+
+    let affinity = match config::read_setting(&dir.join("affinity"))?.as_deref() {
+        None => None,
+        Some("passthrough-devices") => Some(passthrough_device_cpus()?),
+        Some(list) => Some(
+            config::parse_cpu_list(list)
+                .ok_or_else(|| format!("{dir:?}: invalid affinity {list:?}"))?,
+        ),
+    };
+
+    Ok(CpusConfig {
+        boot_vcpus,
+        max_vcpus,
+        topology,
+        // Every vCPU may run on any of the given host CPUs.
+        affinity: affinity.filter(|cpus| !cpus.is_empty()).map(|host_cpus| {
+            (0..max_vcpus)
+                .map(|vcpu| CpuAffinity {
+                    vcpu,
+                    host_cpus: host_cpus.clone(),
+                })
+                .collect()
+        }),
+    })
+}
+
+/// Returns the paths of the disk images in dir, i.e. the files with
+/// names ending in ".img", sorted by name.  A missing dir has none.
+fn images(dir: &Path) -> Result<Vec<PathBuf>, String> {
+    let entries = match dir.read_dir() {
+        Ok(entries) => entries,
+        Err(e) if e.kind() == ErrorKind::NotFound => return Ok(vec![]),
+        Err(e) => return Err(format!("reading directory {dir:?}: {e}")),
+    };
+
+    let mut paths = vec![];
+    for entry in entries {
+        let path = entry
+            .map_err(|e| format!("examining directory entry: {e}"))?
+            .path();
+        if path.extension() == Some(OsStr::new("img")) {
+            paths.push(path);
+        }
+    }
+
+    paths.sort();
+    Ok(paths)
+}
+
+fn pmem_config(path: &Path) -> Result<PmemConfig, String> {
+    let file = path.to_str().unwrap().to_string();
+
+    if file.contains(',') {
+        return Err(format!("illegal ',' character in path {file:?}"));
+    }
+
+    Ok(PmemConfig {
+        file,
+        // The images are read-only, and writes must not reach the
+        // host's copy, which is shared with other VMs.
+        discard_writes: true,
+    })
+}
+
+fn disk_config(path: &Path, default_queues: usize) -> Result<DiskConfig, String> {
+    let entry = path.to_str().unwrap().to_string();
+
+    if entry.contains(',') {
+        return Err(format!("illegal ',' character in path {entry:?}"));
+    }
+
+    // Settings for blk/NAME.img are in blk/NAME.
+    let dir = path.with_extension("");
+
+    let num_queues = match config::read_setting(&dir.join("num_queues"))? {
+        Some(n) => n
+            .parse()
+            .ok()
+            .filter(|&n| n != 0)
+            .ok_or_else(|| format!("{dir:?}: invalid num_queues {n:?}"))?,
+        None => default_queues,
+    };
+
+    let queue_size = match config::read_setting(&dir.join("queue_size"))? {
+        Some(n) => n
+            .parse()
+            .ok()
+            .filter(|&n: &u16| n.is_power_of_two())
+            .ok_or_else(|| format!("{dir:?}: invalid queue_size {n:?}"))?,
+        None => 128,
+    };
+
+    // Cloud Hypervisor checks whether io_uring and AIO work, and falls
+    // back to synchronous I/O if not, so these only need to be turned
+    // off to work around a problem with them.
+    let io_uring = config::read_on_off(&dir.join("io_uring"))?.unwrap_or(true);
+    let aio = config::read_on_off(&dir.join("aio"))?.unwrap_or(true);
+
+    Ok(DiskConfig {
+        path: entry,
+        readonly: true,
+        disable_io_uring: !io_uring,
+        disable_aio: !aio,
+        num_queues,
+        queue_size,
+        // The guest can find a particular disk by its name, since
+        // its device names depend on the order disks were added.
+        serial: dir.file_name().unwrap().to_string_lossy().into_owned(),
+    })
+}
+
+fn fs_config(dir: &Path, socket: String) -> Result<FsConfig, String> {
+    // virtiofsd only has one request queue, so the number of queues
+    // isn't configurable.  Its other settings are read by the
+    // vhost-user-fs service.
+    let queue_size = match config::read_setting(&dir.join("queue_size"))? {
+        Some(n) => n
+            .parse()
+            .ok()
+            .filter(|&n: &u16| n.is_power_of_two())
+            .ok_or_else(|| format!("{dir:?}: invalid queue_size {n:?}"))?,
+        None => 1024,
+    };
+
+    Ok(FsConfig {
+        queue_size,
+        socket,
+        tag: "host",
+    })
+}
+
+fn memory_config(dir: &Path) -> Result<MemoryConfig, String> {
+    let hugepages = config::read_on_off(&dir.join("hugepages"))?.unwrap_or(false);
+    let hugepage_size = config::read_size(&dir.join("hugepage_size"))?;
+
+    if hugepage_size.is_some() && !hugepages {
+        return Err(format!("{dir:?}: hugepage_size requires hugepages"));
+    }
+
+    Ok(MemoryConfig {
+        size: config::read_size(&dir.join("size"))?.unwrap_or(1 << 30),
+        // Required for vhost-user devices.
+        shared: true,
+        hugepages,
+        hugepage_size,
+        prefault: config::read_on_off(&dir.join("prefault"))?.unwrap_or(false),
+        thp: config::read_on_off(&dir.join("thp"))?.unwrap_or(true),
+    })
+}
+
 pub fn vm_config(vm_dir: &Path) -> Result<VmConfig, String> {
     let Some(vm_name) = vm_dir.file_name().unwrap().to_str() else {
         return Err(format!("VM dir {vm_dir:?} is not valid UTF-8"));
@@ -46,56 +275,74 @@ pub fn vm_config(vm_dir: &Path) -> Result<VmConfig, String> {
     let kernel_path = config_dir.join("vmlinux");
     let net_providers_dir = config_dir.join("providers/net");
 
+    let fs_dir =
+        format!("/run/service/vm-services/instance/{vm_name}/data/service/vhost-user-fs/env");
+    let gpu_dir =
+        format!("/run/service/vm-services/instance/{vm_name}/data/service/vhost-user-gpu/env");
+    // The VM the warm pool is cloned from is booted without its
+    // virtio-fs and GPU devices, which are added to each clone once it
+    // has been taken from the pool and its files are ready.  That way,
+    // no device state provided by another process is in the snapshot.
+    let pool_template = config::read_on_off(&config_dir.join("pool-template"))?.unwrap_or(false);
+
+    // A root image in pmem is a bare EROFS filesystem rather than a
+    // partitioned disk, and is mounted with DAX, so the guest uses the
+    // host's page cache for it instead of reading it into its own
+    // memory.
+    let mut pmem_images = images(&config_dir.join("pmem"))?;
+    pmem_images.sort_by_key(|path| path.file_stem() != Some(OsStr::new("root")));
+    let root = if pmem_images
+        .first()
+        .is_some_and(|path| path.file_stem() == Some(OsStr::new("root")))
+    {
+        "root=/dev/pmem0 rootfstype=erofs rootflags=dax=always rootwait"
+    } else {
+        "root=PARTLABEL=root"
+    };
+
+    let cpus = cpus_config(&config_dir.join("cpus"))?;
+    // A queue per vCPU lets each one submit requests without
+    // contending with the others.
+    let disk_queues = cpus.boot_vcpus.into();
+
     Ok(VmConfig {
+        // Memory given back to the host through the balloon could
+        // still be the target of DMA from a passed through device, so
+        // VMs that might have one have to opt out.
+        balloon: if config::read_on_off(&config_dir.join("memory/balloon"))?.unwrap_or(true) {
+            Some(BalloonConfig {
+                size: 0,
+                deflate_on_oom: true,
+                free_page_reporting: true,
+            })
+        } else {
+            None
+        },
         console: ConsoleConfig {
             mode: "Pty",
             file: None,
         },
-        disks: match blk_dir.read_dir() {
-            Ok(entries) => entries
-                .into_iter()
-                .map(|result| {
-                    Ok(result
-                        .map_err(|e| format!("examining directory entry: {e}"))?
-                        .path())
-                })
-                .filter(|result| {
-                    result
-                        .as_ref()
-                        .map_or(true, |entry| entry.extension() == Some(OsStr::new("img")))
-                })
-                .map(|result: Result<_, String>| {
-                    let entry = result?.to_str().unwrap().to_string();
-
-                    if entry.contains(',') {
-                        return Err(format!("illegal ',' character in path {entry:?}"));
-                    }
-
-                    Ok(DiskConfig {
-                        path: entry,
-                        readonly: true,
-                        disable_io_uring: true,
-                        disable_aio: true,
-                    })
-                })
-                .collect::<Result<_, _>>()?,
-            Err(e) => return Err(format!("reading directory {blk_dir:?}: {e}")),
+        cpus,
+        disks: images(&blk_dir)?
+            .iter()
+            .map(|path| disk_config(path, disk_queues))
+            .collect::<Result<_, _>>()?,
+        fs: if pool_template {
+            vec![]
+        } else {
+            vec![fs_config(
+                &config_dir.join("virtiofs"),
+                format!("{fs_dir}/virtiofsd.sock"),
+            )?]
         },
-        fs: [FsConfig {
-            tag: "host",
-            socket: format!(
-                "/run/service/vm-services/instance/{vm_name}/data/service/vhost-user-fs/env/virtiofsd.sock"
-            ),
-        }],
-        gpu: [GpuConfig {
-            socket: format!(
-                "/run/service/vm-services/instance/{vm_name}/data/service/vhost-user-gpu/env/crosvm.sock"
-            ),
-        }],
-        memory: MemoryConfig {
-            size: 1 << 30,
-            shared: true,
+        gpu: if pool_template {
+            vec![]
+        } else {
+            vec![GpuConfig {
+                socket: format!("{gpu_dir}/crosvm.sock"),
+            }]
         },
+        memory: memory_config(&config_dir.join("memory"))?,
         net: match net_providers_dir.read_dir() {
             Ok(entries) => entries
                 .into_iter()
@@ -155,10 +402,14 @@ pub fn vm_config(vm_dir: &Path) -> Result<VmConfig, String> {
         payload: PayloadConfig {
             kernel: kernel_path.to_str().unwrap().to_string(),
             #[cfg(target_arch = "x86_64")]
-            cmdline: "console=ttyS0 root=PARTLABEL=root",
+            cmdline: format!("console=ttyS0 {root}"),
             #[cfg(not(target_arch = "x86_64"))]
-            cmdline: "root=PARTLABEL=root",
+            cmdline: root.to_string(),
         },
+        pmem: pmem_images
+            .iter()
+            .map(|path| pmem_config(path))
+            .collect::<Result<_, _>>()?,
         serial: ConsoleConfig {
             mode: "File",
             file: Some(format!("/run/vm/by-id/{vm_name}/serial")),
@@ -168,21 +419,66 @@ pub fn vm_config(vm_dir: &Path) -> Result<VmConfig, String> {
             socket: format!("/run/vsock/{vm_name}/vsock"),
         },
         landlock_enable: true,
-        landlock_rules: [
-            LandlockConfig {
-                path: "/sys/devices",
-                access: "rw",
-            },
-            LandlockConfig {
-                path: "/dev/vfio",
-                access: "rw",
-            },
-        ],
+        landlock_rules: {
+            let mut rules = vec![
+                LandlockConfig {
+                    path: "/sys/devices".to_string(),
+                    access: "rw",
+                },
+                LandlockConfig {
+                    path: "/dev/vfio".to_string(),
+                    access: "rw",
+                },
+            ];
+            // Cloud Hypervisor only allows access to the paths in its
+            // configuration, so the sockets of the devices that will be
+            // added later, images that might be added with them, and
+            // the snapshot, have to be allowed explicitly.
+            if pool_template {
+                rules.push(LandlockConfig {
+                    path: fs_dir,
+                    access: "rw",
+                });
+                rules.push(LandlockConfig {
+                    path: gpu_dir,
+                    access: "rw",
+                });
+                rules.push(LandlockConfig {
+                    path: format!("/run/vm/by-id/{vm_name}/config/pmem"),
+                    access: "r",
+                });
+                rules.push(LandlockConfig {
+                    path: "/run/vm-pool/snapshot".to_string(),
+                    access: "rw",
+                });
+            }
+            rules
+        },
     })
 }
 
 pub fn create_vm(vm_dir: &Path, ready_fd: File) -> Result<(), String> {
-    let config = vm_config(vm_dir)?;
+    let _span = Span::begin(vm_dir, "start-vmm");
+
+    // A VM taken from the warm pool is restored from the pool's
+    // snapshot rather than being created from its configuration.
+    let restore_path = vm_dir.join("restore");
+    match restore_path.read_link() {
+        Ok(snapshot) => {
+            let Some(snapshot) = snapshot.to_str() else {
+                return Err(format!("{restore_path:?} target is not valid UTF-8"));
+            };
+            return ch::restore_vm(vm_dir, ready_fd, snapshot)
+                .map_err(|e| format!("restoring VM from {snapshot:?}: {e}"));
+        }
+        Err(e) if e.kind() == ErrorKind::NotFound => {}
+        Err(e) => return Err(format!("reading {restore_path:?}: {e}")),
+    }
+
+    let config = {
+        let _span = Span::begin(vm_dir, "vm-config");
+        vm_config(vm_dir)?
+    };
 
     ch::create_vm(vm_dir, ready_fd, config).map_err(|e| format!("creating VM: {e}"))
 }
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::fs::{File, create_dir_all, write};
+
+use start_vmm::vm_config;
+use test_helper::TempDir;
+
+fn main() -> std::io::Result<()> {
+    let tmp_dir = TempDir::new()?;
+
+    let vm_dir = tmp_dir.path().join("testvm");
+    let config_dir = vm_dir.join("config");
+    let cpus_dir = config_dir.join("cpus");
+
+    create_dir_all(config_dir.join("blk"))?;
+    create_dir_all(&cpus_dir)?;
+    File::create(config_dir.join("vmlinux"))?;
+    File::create(config_dir.join("blk/root.img"))?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.cpus.boot_vcpus, 1);
+    assert_eq!(config.cpus.max_vcpus, 1);
+    assert!(config.cpus.topology.is_none());
+    assert!(config.cpus.affinity.is_none());
+    assert_eq!(config.disks[0].num_queues, 1);
+
+    write(cpus_dir.join("boot"), "4\n")?;
+    write(cpus_dir.join("max"), "8\n")?;
+    write(cpus_dir.join("topology"), "2:2:1:2\n")?;
+    write(cpus_dir.join("affinity"), "0-1,3\n")?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.cpus.boot_vcpus, 4);
+    assert_eq!(config.cpus.max_vcpus, 8);
+    let topology = config.cpus.topology.unwrap();
+    assert_eq!(topology.threads_per_core, 2);
+    assert_eq!(topology.cores_per_die, 2);
+    assert_eq!(topology.dies_per_package, 1);
+    assert_eq!(topology.packages, 2);
+    let affinity = config.cpus.affinity.unwrap();
+    assert_eq!(affinity.len(), 8);
+    for (i, vcpu) in affinity.iter().enumerate() {
+        assert_eq!(usize::from(vcpu.vcpu), i);
+        assert_eq!(vcpu.host_cpus, [0, 1, 3]);
+    }
+    assert_eq!(config.disks[0].num_queues, 4);
+
+    write(cpus_dir.join("topology"), "2:2\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("THREADS:CORES:DIES:PACKAGES"), "{e}");
+
+    write(cpus_dir.join("topology"), "2:2:1:2\n")?;
+    write(cpus_dir.join("max"), "2\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("max is less than boot"), "{e}");
+
+    Ok(())
+}
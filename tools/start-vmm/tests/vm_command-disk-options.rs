@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::fs::{File, create_dir_all, write};
+
+use start_vmm::vm_config;
+use test_helper::TempDir;
+
+fn main() -> std::io::Result<()> {
+    let tmp_dir = TempDir::new()?;
+
+    let vm_dir = tmp_dir.path().join("testvm");
+    let config_dir = vm_dir.join("config");
+    let options_dir = config_dir.join("blk/root");
+
+    create_dir_all(&options_dir)?;
+    File::create(config_dir.join("vmlinux"))?;
+    File::create(config_dir.join("blk/root.img"))?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.disks.len(), 1);
+    let disk = &config.disks[0];
+    assert!(!disk.disable_io_uring);
+    assert!(!disk.disable_aio);
+    assert_eq!(disk.num_queues, 1);
+    assert_eq!(disk.queue_size, 128);
+
+    write(options_dir.join("num_queues"), "4\n")?;
+    write(options_dir.join("queue_size"), "256\n")?;
+    write(options_dir.join("io_uring"), "off\n")?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.disks.len(), 1);
+    let disk = &config.disks[0];
+    assert!(disk.disable_io_uring);
+    assert!(!disk.disable_aio);
+    assert_eq!(disk.num_queues, 4);
+    assert_eq!(disk.queue_size, 256);
+
+    write(options_dir.join("queue_size"), "100\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("invalid queue_size"), "{e}");
+
+    write(options_dir.join("queue_size"), "256\n")?;
+    write(options_dir.join("num_queues"), "0\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("invalid num_queues"), "{e}");
+
+    Ok(())
+}
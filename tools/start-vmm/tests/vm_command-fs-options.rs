@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::fs::{File, create_dir_all, write};
+
+use start_vmm::vm_config;
+use test_helper::TempDir;
+
+fn main() -> std::io::Result<()> {
+    let tmp_dir = TempDir::new()?;
+
+    let vm_dir = tmp_dir.path().join("testvm");
+    let config_dir = vm_dir.join("config");
+    let options_dir = config_dir.join("virtiofs");
+
+    create_dir_all(&options_dir)?;
+    create_dir_all(config_dir.join("blk"))?;
+    File::create(config_dir.join("vmlinux"))?;
+    File::create(config_dir.join("blk/root.img"))?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.fs.len(), 1);
+    assert_eq!(config.fs[0].queue_size, 1024);
+
+    write(options_dir.join("queue_size"), "4096\n")?;
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.fs[0].queue_size, 4096);
+
+    write(options_dir.join("queue_size"), "1000\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("invalid queue_size"), "{e}");
+
+    Ok(())
+}
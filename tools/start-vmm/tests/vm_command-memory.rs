@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::fs::{File, create_dir_all, write};
+
+use start_vmm::vm_config;
+use test_helper::TempDir;
+
+fn main() -> std::io::Result<()> {
+    let tmp_dir = TempDir::new()?;
+
+    let vm_dir = tmp_dir.path().join("testvm");
+    let config_dir = vm_dir.join("config");
+    let memory_dir = config_dir.join("memory");
+
+    create_dir_all(config_dir.join("blk"))?;
+    create_dir_all(&memory_dir)?;
+    File::create(config_dir.join("vmlinux"))?;
+    File::create(config_dir.join("blk/root.img"))?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.memory.size, 0x40000000);
+    assert!(!config.memory.hugepages);
+    assert_eq!(config.memory.hugepage_size, None);
+    assert!(!config.memory.prefault);
+    assert!(config.memory.thp);
+    let balloon = config.balloon.unwrap();
+    assert_eq!(balloon.size, 0);
+    assert!(balloon.deflate_on_oom);
+    assert!(balloon.free_page_reporting);
+
+    write(memory_dir.join("size"), "4G\n")?;
+    write(memory_dir.join("hugepages"), "on\n")?;
+    write(memory_dir.join("hugepage_size"), "2M\n")?;
+    write(memory_dir.join("prefault"), "on\n")?;
+    write(memory_dir.join("thp"), "off\n")?;
+    write(memory_dir.join("balloon"), "off\n")?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.memory.size, 0x100000000);
+    assert!(config.memory.shared);
+    assert!(config.memory.hugepages);
+    assert_eq!(config.memory.hugepage_size, Some(0x200000));
+    assert!(config.memory.prefault);
+    assert!(!config.memory.thp);
+    assert!(config.balloon.is_none());
+
+    write(memory_dir.join("hugepages"), "off\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("hugepage_size requires hugepages"), "{e}");
+
+    write(memory_dir.join("hugepages"), "yes\n")?;
+    let e = vm_config(&vm_dir).err().unwrap();
+    assert!(e.contains("\"on\" or \"off\""), "{e}");
+
+    Ok(())
+}
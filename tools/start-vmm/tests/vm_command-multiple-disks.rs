@@ -30,6 +30,9 @@ fn main() -> std::io::Result<()> {
     assert_eq!(config.disks.len(), 2);
     assert!(config.disks.iter().all(|disk| disk.readonly));
 
+    let serials: BTreeSet<_> = config.disks.iter().map(|disk| &*disk.serial).collect();
+    assert_eq!(serials, BTreeSet::from(["disk1", "disk2"]));
+
     let actual_paths: BTreeSet<_> = config
         .disks
         .into_iter()
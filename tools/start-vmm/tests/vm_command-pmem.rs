@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::fs::{File, create_dir_all};
+use std::path::PathBuf;
+
+use start_vmm::vm_config;
+use test_helper::TempDir;
+
+fn main() -> std::io::Result<()> {
+    let tmp_dir = TempDir::new()?;
+
+    let vm_dir = tmp_dir.path().join("testvm");
+    let config_dir = vm_dir.join("config");
+    let pmem_dir = config_dir.join("pmem");
+
+    create_dir_all(&pmem_dir)?;
+    File::create(config_dir.join("vmlinux"))?;
+    File::create(pmem_dir.join("data.img"))?;
+    File::create(pmem_dir.join("root.img"))?;
+    File::create(pmem_dir.join("README"))?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert!(config.disks.is_empty());
+    let files: Vec<_> = config.pmem.iter().map(|p| PathBuf::from(&p.file)).collect();
+    assert_eq!(
+        files,
+        [pmem_dir.join("root.img"), pmem_dir.join("data.img")]
+    );
+    assert!(config.pmem.iter().all(|p| p.discard_writes));
+    assert!(
+        config
+            .payload
+            .cmdline
+            .ends_with("root=/dev/pmem0 rootfstype=erofs rootflags=dax=always rootwait")
+    );
+
+    Ok(())
+}
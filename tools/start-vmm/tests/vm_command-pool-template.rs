@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::fs::{File, create_dir_all, write};
+
+use start_vmm::vm_config;
+use test_helper::TempDir;
+
+fn main() -> std::io::Result<()> {
+    let tmp_dir = TempDir::new()?;
+
+    let vm_dir = tmp_dir.path().join("testvm");
+    let config_dir = vm_dir.join("config");
+
+    create_dir_all(config_dir.join("blk"))?;
+    File::create(config_dir.join("vmlinux"))?;
+    File::create(config_dir.join("blk/root.img"))?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert_eq!(config.fs.len(), 1);
+    assert_eq!(config.gpu.len(), 1);
+    assert_eq!(config.landlock_rules.len(), 2);
+
+    write(config_dir.join("pool-template"), "on\n")?;
+
+    let config = vm_config(&vm_dir).unwrap();
+    assert!(config.fs.is_empty());
+    assert!(config.gpu.is_empty());
+    let paths: Vec<_> = config.landlock_rules.iter().map(|r| &r.path).collect();
+    assert_eq!(
+        paths[2..],
+        [
+            "/run/service/vm-services/instance/testvm/data/service/vhost-user-fs/env",
+            "/run/service/vm-services/instance/testvm/data/service/vhost-user-gpu/env",
+            "/run/vm/by-id/testvm/config/pmem",
+            "/run/vm-pool/snapshot",
+        ]
+    );
+
+    Ok(())
+}
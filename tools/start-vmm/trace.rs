@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+//! Adds events to a VM's trace, in the format read by `timeline show`.
+
+use std::fs::OpenOptions;
+use std::io::Write;
+use std::os::raw::{c_int, c_long};
+use std::path::{Path, PathBuf};
+
+const CLOCK_BOOTTIME: c_int = 7;
+
+#[repr(C)]
+struct Timespec {
+    tv_sec: c_long,
+    tv_nsec: c_long,
+}
+
+// SAFETY: declaration is compatible with C.
+unsafe extern "C" {
+    fn clock_gettime(clockid: c_int, tp: *mut Timespec) -> c_int;
+}
+
+fn record(trace: &Path, kind: &str, name: &str) {
+    let mut ts = Timespec {
+        tv_sec: 0,
+        tv_nsec: 0,
+    };
+    // SAFETY: we pass a valid timespec.
+    if unsafe { clock_gettime(CLOCK_BOOTTIME, &mut ts) } == -1 {
+        return;
+    }
+
+    // Tracing is best effort, so it can't make starting the VM fail.
+    // The line is written in one go so that it isn't interleaved with
+    // events being added by other processes.
+    let line = format!("{}{:09} {kind} {name}\n", ts.tv_sec, ts.tv_nsec);
+    if let Ok(mut file) = OpenOptions::new().append(true).create(true).open(trace) {
+        let _ = file.write_all(line.as_bytes());
+    }
+}
+
+/// A step that begins when the Span is created and ends when it's
+/// dropped.
+pub struct Span {
+    trace: PathBuf,
+    name: &'static str,
+}
+
+impl Span {
+    pub fn begin(vm_dir: &Path, name: &'static str) -> Self {
+        let trace = vm_dir.join("trace");
+        record(&trace, "begin", name);
+        Self { trace, name }
+    }
+}
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        record(&self.trace, "end", self.name);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{create_dir, read_to_string, remove_dir_all};
+
+    #[test]
+    fn span() {
+        let dir = std::env::temp_dir().join(format!(
+            "spectrum-start-vmm-trace-test.{}",
+            std::process::id()
+        ));
+        create_dir(&dir).unwrap();
+        drop(Span::begin(&dir, "test"));
+        let trace = read_to_string(dir.join("trace")).unwrap();
+        remove_dir_all(&dir).unwrap();
+
+        let events: Vec<Vec<&str>> = trace
+            .lines()
+            .map(|line| line.split(' ').collect())
+            .collect();
+        assert_eq!(events.len(), 2, "unexpected trace: {trace:?}");
+        assert_eq!(&events[0][1..], ["begin", "test"]);
+        assert_eq!(&events[1][1..], ["end", "test"]);
+        let begin: u64 = events[0][0].parse().unwrap();
+        let end: u64 = events[1][0].parse().unwrap();
+        assert!(begin <= end, "unexpected trace: {trace:?}");
+    }
+}
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+use std::env::args_os;
+use std::io::{Write, stdout};
+use std::os::unix::prelude::*;
+use std::path::Path;
+use std::process::exit;
+
+use start_vmm::{api_request, prog_name};
+
+fn ex_usage() -> ! {
+    eprintln!("Usage: vm-api vm endpoint [json]");
+    exit(1);
+}
+
+fn run() -> Result<(), String> {
+    let mut args = args_os().skip(1);
+    let (Some(vm_id), Some(endpoint)) = (args.next(), args.next()) else {
+        ex_usage();
+    };
+    let body = args.next();
+    if args.next().is_some() {
+        ex_usage();
+    }
+
+    if vm_id.as_bytes().contains(&b'/') {
+        return Err(format!("invalid VM ID {vm_id:?}"));
+    }
+    let Some(endpoint) = endpoint.to_str() else {
+        return Err(format!("endpoint {endpoint:?} is not valid UTF-8"));
+    };
+    let body = match body {
+        Some(body) => match body.into_string() {
+            Ok(body) => Some(body),
+            Err(body) => return Err(format!("request body {body:?} is not valid UTF-8")),
+        },
+        None => None,
+    };
+
+    let vm_dir = Path::new("/run/vm/by-id").join(vm_id);
+    let response = api_request(&vm_dir, endpoint, body.as_deref())?;
+
+    if !response.is_empty() {
+        writeln!(stdout(), "{response}").map_err(|e| format!("writing output: {e}"))?;
+    }
+
+    Ok(())
+}
+
+fn main() {
+    if let Err(e) = run() {
+        eprintln!("{}: {e}", prog_name());
+        exit(1);
+    }
+}
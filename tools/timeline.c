@@ -0,0 +1,490 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Records the steps of booting the host or starting a VM in a trace
+// file, and shows where the time went.
+//
+// A trace has a line for each event, with the time it happened in
+// nanoseconds since boot (CLOCK_BOOTTIME), whether it was the
+// beginning or end of a step or a mark, and a name.  Lines are short
+// and written with a single write to a file opened with O_APPEND, so
+// scripts and programs running at the same time can add to the same
+// trace without their events getting mixed up.
+//
+// Cloud Hypervisor writes its own events, with times relative to when
+// it started, so they're placed in the timeline relative to the
+// "cloud-hypervisor" mark that run-vmm adds just before starting it.
+//
+// A VM from the warm pool is started long before it's used, so
+// showing a trace can start from the last of a given mark, like the
+// one vm-pool-take adds when the VM is taken from the pool.
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#define VMM_MARK "cloud-hypervisor"
+
+enum kind { BEGIN, END, MARK };
+
+static const char *const kinds[] = { "begin", "end", "mark" };
+
+struct event {
+	int64_t time;
+	enum kind kind;
+	char *name;
+	size_t n;
+};
+
+struct span {
+	const char *name;
+	int64_t begin, end, critical;
+	bool finished;
+};
+
+struct events {
+	struct event *events;
+	size_t len, cap;
+};
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: timeline begin|end|mark TRACE NAME\n"
+	      "       timeline span TRACE NAME PROG...\n"
+	      "       timeline show [-s MARK] TRACE [EVENTS]\n",
+	      stderr);
+	exit(EXIT_FAILURE);
+}
+
+// Adds an event to a trace, and returns whether it could.
+static bool record(enum kind kind, const char path[static 1], const char name[static 1])
+{
+	struct timespec ts;
+	char line[256];
+	int fd, len;
+
+	if (!*name || strpbrk(name, " \t\n")) {
+		warnx("invalid event name: %s", name);
+		return false;
+	}
+
+	if (clock_gettime(CLOCK_BOOTTIME, &ts) == -1) {
+		warn("clock_gettime");
+		return false;
+	}
+	len = snprintf(line, sizeof line, "%jd%09ld %s %s\n",
+	               (intmax_t)ts.tv_sec, ts.tv_nsec, kinds[kind], name);
+	if (len < 0 || (size_t)len >= sizeof line) {
+		warnx("event name too long: %s", name);
+		return false;
+	}
+
+	if ((fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)) == -1) {
+		warn("open %s", path);
+		return false;
+	}
+	if (write(fd, line, len) != len) {
+		warn("write %s", path);
+		close(fd);
+		return false;
+	}
+	if (close(fd) == -1) {
+		warn("close %s", path);
+		return false;
+	}
+	return true;
+}
+
+// Runs a program as a step, and exits like it did.  The program is run
+// even if the step can't be recorded, so that tracing can't make
+// whatever is being traced fail.
+noreturn static void do_span(const char path[static 1], const char name[static 1],
+                             char *argv[])
+{
+	int status;
+	pid_t pid;
+
+	record(BEGIN, path, name);
+
+	if ((pid = fork()) == -1)
+		err(EXIT_FAILURE, "fork");
+	if (!pid) {
+		execvp(argv[0], argv);
+		err(errno == ENOENT ? 127 : 126, "exec %s", argv[0]);
+	}
+	while (waitpid(pid, &status, 0) == -1)
+		if (errno != EINTR)
+			err(EXIT_FAILURE, "waitpid");
+
+	record(END, path, name);
+
+	if (WIFSIGNALED(status))
+		exit(128 + WTERMSIG(status));
+	exit(WEXITSTATUS(status));
+}
+
+static void push(struct events events[static 1], int64_t time, enum kind kind,
+                 char name[static 1])
+{
+	if (events->len == events->cap) {
+		events->cap = events->cap ? events->cap * 2 : 256;
+		if (!(events->events = reallocarray(events->events, events->cap,
+		                                    sizeof *events->events)))
+			err(EXIT_FAILURE, "reallocarray");
+	}
+	events->events[events->len] = (struct event) {
+		.time = time,
+		.kind = kind,
+		.name = name,
+		.n = events->len,
+	};
+	events->len++;
+}
+
+static void read_trace(struct events events[static 1], const char path[static 1])
+{
+	char *line = nullptr, kind[6], *name;
+	size_t size = 0, n = 0;
+	intmax_t time;
+	ssize_t len;
+	int end;
+	FILE *f;
+
+	if (!(f = fopen(path, "re")))
+		err(EXIT_FAILURE, "fopen %s", path);
+
+	while ((len = getline(&line, &size, f)) != -1) {
+		n++;
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		end = 0;
+		if (sscanf(line, "%jd %5s %n", &time, kind, &end) != 2 || !end ||
+		    !line[end])
+			errx(EXIT_FAILURE, "%s:%zu: malformed line", path, n);
+		if (!(name = strdup(line + end)))
+			err(EXIT_FAILURE, "strdup");
+
+		if (!strcmp(kind, "begin"))
+			push(events, time, BEGIN, name);
+		else if (!strcmp(kind, "end"))
+			push(events, time, END, name);
+		else if (!strcmp(kind, "mark"))
+			push(events, time, MARK, name);
+		else
+			errx(EXIT_FAILURE, "%s:%zu: unknown event kind", path, n);
+	}
+	if (ferror(f))
+		err(EXIT_FAILURE, "getline %s", path);
+
+	free(line);
+	fclose(f);
+}
+
+// Returns a pointer to the value of the first member of a JSON object
+// with the given key, or nullptr if there isn't one.  Only good enough
+// for the events Cloud Hypervisor writes, in which no string contains
+// another key in quotes.
+static const char *json_member(const char obj[static 1], const char key[static 1])
+{
+	size_t len = strlen(key);
+	const char *p = obj;
+
+	while ((p = strchr(p, '"'))) {
+		p++;
+		if (strncmp(p, key, len) || p[len] != '"')
+			continue;
+		p += len + 1;
+		p += strspn(p, " \t\n");
+		if (*p++ != ':')
+			continue;
+		return p + strspn(p, " \t\n");
+	}
+	return nullptr;
+}
+
+static char *json_string(const char obj[static 1], const char key[static 1])
+{
+	const char *value = json_member(obj, key), *end;
+
+	if (!value || *value != '"' || !(end = strchr(value + 1, '"')))
+		return nullptr;
+	return strndup(value + 1, end - value - 1);
+}
+
+// Adds the events of a Cloud Hypervisor event log as marks.  run-vmm
+// starts a new log each time it starts the VMM, so the log's times are
+// from the last "cloud-hypervisor" mark in the trace.
+static void read_vmm_events(struct events events[static 1], const char path[static 1])
+{
+	size_t len = 0, cap = 0, start = events->len;
+	char *buf = nullptr, *obj, *source, *event, *name;
+	const char *secs, *nanos;
+	int64_t time;
+	int depth = 0;
+	ssize_t r;
+	int fd;
+
+	while (start-- && (events->events[start].kind != MARK ||
+	                   strcmp(events->events[start].name, VMM_MARK)));
+	if (start == SIZE_MAX) {
+		warnx("%s: no %s mark for VMM start", path, VMM_MARK);
+		return;
+	}
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", path);
+	do {
+		if (len + 4096 + 1 > cap) {
+			cap = cap ? cap * 2 : 65536;
+			if (!(buf = realloc(buf, cap)))
+				err(EXIT_FAILURE, "realloc");
+		}
+		if ((r = read(fd, buf + len, cap - len - 1)) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "read %s", path);
+		}
+		len += r;
+	} while (r);
+	buf[len] = '\0';
+	close(fd);
+
+	// Cloud Hypervisor pretty-prints its events, so they're split
+	// into top-level objects by counting braces.
+	for (char *p = buf, *obj_start = buf; *p; p++) {
+		if (*p == '"' && depth) {
+			while (*++p && *p != '"')
+				if (*p == '\\' && p[1])
+					p++;
+			if (!*p)
+				break;
+			continue;
+		}
+		if (*p == '{' && !depth++)
+			obj_start = p;
+		if (*p != '}' || !depth || --depth)
+			continue;
+
+		*p = '\0';
+		obj = obj_start;
+		secs = json_member(obj, "secs");
+		nanos = json_member(obj, "nanos");
+		source = json_string(obj, "source");
+		event = json_string(obj, "event");
+		if (!secs || !nanos || !source || !event) {
+			warnx("%s: skipping malformed event", path);
+			free(source);
+			free(event);
+			continue;
+		}
+		time = strtoll(secs, nullptr, 10) * 1000000000 + strtoll(nanos, nullptr, 10);
+
+		if (asprintf(&name, VMM_MARK " %s %s", source, event) == -1)
+			err(EXIT_FAILURE, "asprintf");
+		free(source);
+		free(event);
+		push(events, events->events[start].time + time, MARK, name);
+	}
+
+	free(buf);
+}
+
+static int compare_time(const void *a, const void *b)
+{
+	const struct event *ea = a, *eb = b;
+
+	if (ea->time != eb->time)
+		return ea->time < eb->time ? -1 : 1;
+	return ea->n < eb->n ? -1 : ea->n > eb->n;
+}
+
+static int compare_critical(const void *a, const void *b)
+{
+	const struct span *sa = *(struct span *const *)a, *sb = *(struct span *const *)b;
+
+	if (sa->critical != sb->critical)
+		return sa->critical > sb->critical ? -1 : 1;
+	return sa->begin < sb->begin ? -1 : sa->begin > sb->begin;
+}
+
+static double ms(int64_t ns)
+{
+	return ns / 1e6;
+}
+
+// Removes the events before the last of the given mark.
+static void start_from(struct events events[static 1], const char mark[static 1])
+{
+	size_t start = events->len;
+
+	while (start-- && (events->events[start].kind != MARK ||
+	                   strcmp(events->events[start].name, mark)));
+	if (start == SIZE_MAX)
+		errx(EXIT_FAILURE, "no %s mark", mark);
+
+	events->len -= start;
+	memmove(events->events, events->events + start,
+	        events->len * sizeof *events->events);
+}
+
+static void do_show(const char path[static 1], const char *vmm_events,
+                    const char *start_mark)
+{
+	struct span *spans, **by_critical, *innermost;
+	size_t spans_len = 0, depth;
+	int64_t first, total, untraced = 0;
+	struct events events = {};
+	struct event *e;
+
+	read_trace(&events, path);
+	if (vmm_events)
+		read_vmm_events(&events, vmm_events);
+	if (!events.len)
+		errx(EXIT_FAILURE, "%s: no events", path);
+
+	qsort(events.events, events.len, sizeof *events.events, compare_time);
+	if (start_mark)
+		start_from(&events, start_mark);
+	first = events.events[0].time;
+	total = events.events[events.len - 1].time - first;
+
+	if (!(spans = calloc(events.len, sizeof *spans)) ||
+	    !(by_critical = calloc(events.len, sizeof *by_critical)))
+		err(EXIT_FAILURE, "calloc");
+
+	// Each end is matched with the most recent unfinished begin of the
+	// same name.  Steps that never finished are treated as lasting
+	// until the last event.
+	for (size_t i = 0; i < events.len; i++) {
+		e = &events.events[i];
+		if (e->kind == BEGIN) {
+			spans[spans_len++] = (struct span) {
+				.name = e->name,
+				.begin = e->time,
+				.end = events.events[events.len - 1].time,
+			};
+			continue;
+		}
+		if (e->kind != END)
+			continue;
+		for (size_t j = spans_len; j--;) {
+			if (spans[j].finished || strcmp(spans[j].name, e->name))
+				continue;
+			spans[j].end = e->time;
+			spans[j].finished = true;
+			break;
+		}
+	}
+
+	if (printf("%s starts %.3f s after boot\n\n"
+	           "%10s %10s  %s\n",
+	           path, first / 1e9, "TIME(ms)", "TOOK(ms)", "STEP") < 0)
+		err(EXIT_FAILURE, "printf");
+
+	for (size_t i = 0, span = 0; i < events.len; i++) {
+		e = &events.events[i];
+		if (e->kind == END)
+			continue;
+
+		depth = 0;
+		for (size_t j = 0; j < spans_len; j++)
+			if (spans[j].begin <= e->time && spans[j].end > e->time &&
+			    (e->kind == MARK || j < span))
+				depth++;
+
+		if (e->kind == MARK) {
+			if (printf("%10.3f %10s  %*s%s\n", ms(e->time - first), "",
+			           (int)depth * 2, "", e->name) < 0)
+				err(EXIT_FAILURE, "printf");
+			continue;
+		}
+
+		if (printf("%10.3f %10.3f  %*s%s%s\n", ms(e->time - first),
+		           ms(spans[span].end - spans[span].begin), (int)depth * 2, "",
+		           e->name, spans[span].finished ? "" : " (unfinished)") < 0)
+			err(EXIT_FAILURE, "printf");
+		span++;
+	}
+
+	// Between each pair of events, the time is put down to the step
+	// that began most recently and is still going, since any other
+	// step going on at the same time is waiting for it or for
+	// something it started.
+	for (size_t i = 0; i + 1 < events.len; i++) {
+		int64_t start = events.events[i].time, end = events.events[i + 1].time;
+
+		innermost = nullptr;
+		for (size_t j = 0; j < spans_len; j++)
+			if (spans[j].begin <= start && spans[j].end >= end)
+				innermost = &spans[j];
+		if (innermost)
+			innermost->critical += end - start;
+		else
+			untraced += end - start;
+	}
+
+	for (size_t i = 0; i < spans_len; i++)
+		by_critical[i] = &spans[i];
+	qsort(by_critical, spans_len, sizeof *by_critical, compare_critical);
+
+	if (printf("\nCritical path (%.3f ms)\n\n"
+	           "%10s %6s  %s\n", ms(total), "TIME(ms)", "%", "STEP") < 0)
+		err(EXIT_FAILURE, "printf");
+	for (size_t i = 0; i < spans_len && by_critical[i]->critical; i++)
+		if (printf("%10.3f %6.1f  %s\n", ms(by_critical[i]->critical),
+		           100.0 * by_critical[i]->critical / total,
+		           by_critical[i]->name) < 0)
+			err(EXIT_FAILURE, "printf");
+	if (untraced && printf("%10.3f %6.1f  (untraced)\n", ms(untraced),
+	                       100.0 * untraced / total) < 0)
+		err(EXIT_FAILURE, "printf");
+
+	if (fflush(stdout) == EOF)
+		err(EXIT_FAILURE, "fflush");
+}
+
+static void show(int argc, char *argv[])
+{
+	char *start_mark = nullptr;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "+s:")) != -1) {
+		if (opt != 's')
+			ex_usage();
+		start_mark = optarg;
+	}
+	if (argc - optind != 1 && argc - optind != 2)
+		ex_usage();
+
+	do_show(argv[optind], argv[optind + 1], start_mark);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+		ex_usage();
+
+	if (!strcmp(argv[1], "begin") && argc == 4)
+		return !record(BEGIN, argv[2], argv[3]);
+	if (!strcmp(argv[1], "end") && argc == 4)
+		return !record(END, argv[2], argv[3]);
+	if (!strcmp(argv[1], "mark") && argc == 4)
+		return !record(MARK, argv[2], argv[3]);
+	if (!strcmp(argv[1], "span") && argc > 4)
+		do_span(argv[2], argv[3], argv + 4);
+	if (!strcmp(argv[1], "show"))
+		show(argc - 1, argv + 1);
+	else
+		ex_usage();
+}
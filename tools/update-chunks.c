@@ -0,0 +1,312 @@
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+// SPDX-License-Identifier: EUPL-1.2+
+
+// Splits images into fixed-size chunks named by their SHA-256 digests,
+// and puts images back together from chunks, so that an update only
+// has to download the chunks of the new root filesystem image that
+// the running one doesn't already have.
+//
+// An index has a line for each chunk of an image, in order, with the
+// chunk's digest in hex and its length in bytes.  Every chunk except
+// the last is CHUNK_SIZE bytes long.
+//
+// Chunks downloaded by the update VM aren't trusted, and neither is
+// the index, so each chunk is checked against its digest as it's
+// used, and the assembled image is checked against the signed
+// SHA256SUMS by systemd-sysupdate.  Because an index can name the same
+// chunk any number of times, the caller also gives a size that the
+// assembled image can't be bigger than.
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sha256.h"
+
+#define CHUNK_SIZE 65536
+
+struct chunk {
+	unsigned char digest[32];
+	size_t len;
+	off_t off;
+};
+
+struct index {
+	struct chunk *chunks;
+	size_t len, cap;
+};
+
+noreturn static void ex_usage(void)
+{
+	fputs("Usage: update-chunks index IMAGE [DIR]\n"
+	      "       update-chunks assemble INDEX DIR OUT MAX_SIZE [SEED SEED_INDEX]\n",
+	      stderr);
+	exit(EXIT_FAILURE);
+}
+
+static void push(struct index index[static 1], const struct chunk chunk[static 1])
+{
+	if (index->len == index->cap) {
+		index->cap = index->cap ? index->cap * 2 : 1024;
+		if (!(index->chunks = reallocarray(index->chunks, index->cap,
+		                                   sizeof *index->chunks)))
+			err(EXIT_FAILURE, "reallocarray");
+	}
+	index->chunks[index->len++] = *chunk;
+}
+
+static size_t read_full(int fd, void *buf, size_t len, off_t off)
+{
+	char *p = buf;
+	ssize_t r;
+
+	while (len) {
+		if ((r = pread(fd, p, len, off)) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "pread");
+		}
+		if (!r)
+			break;
+		p += r;
+		off += r;
+		len -= r;
+	}
+	return p - (char *)buf;
+}
+
+static void write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	while (len) {
+		if ((r = write(fd, p, len)) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "write");
+		}
+		p += r;
+		len -= r;
+	}
+}
+
+static void digest(unsigned char out[static 32], const void *buf, size_t len)
+{
+	struct sha256 ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, buf, len);
+	sha256_final(&ctx, out);
+}
+
+static void chunk_name(char name[static 71], const unsigned char digest[static 32])
+{
+	memcpy(name, "Chunk_", 6);
+	sha256_hex(digest, name + 6);
+}
+
+static int compare_digest(const void *a, const void *b)
+{
+	return memcmp(((const struct chunk *)a)->digest,
+	              ((const struct chunk *)b)->digest, 32);
+}
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+// Reads an index, which might have come from the update VM, so is
+// parsed strictly.
+static void read_index(struct index index[static 1], const char path[static 1])
+{
+	struct chunk chunk;
+	char *line = nullptr, *end;
+	size_t size = 0, n = 0;
+	off_t off = 0;
+	ssize_t len;
+	FILE *f;
+
+	if (!(f = fopen(path, "re")))
+		err(EXIT_FAILURE, "fopen %s", path);
+
+	while ((len = getline(&line, &size, f)) != -1) {
+		n++;
+		if (len < 67 || line[64] != ' ' || line[len - 1] != '\n')
+			errx(EXIT_FAILURE, "%s:%zu: malformed line", path, n);
+		for (int i = 0; i < 32; i++) {
+			int hi = hex_digit(line[i * 2]), lo = hex_digit(line[i * 2 + 1]);
+			if (hi == -1 || lo == -1)
+				errx(EXIT_FAILURE, "%s:%zu: malformed digest", path, n);
+			chunk.digest[i] = hi << 4 | lo;
+		}
+
+		errno = 0;
+		chunk.len = strtoul(line + 65, &end, 10);
+		if (errno || end != line + len - 1 || line[65] < '1' || line[65] > '9' ||
+		    chunk.len > CHUNK_SIZE)
+			errx(EXIT_FAILURE, "%s:%zu: malformed length", path, n);
+		chunk.off = off;
+		off += chunk.len;
+
+		push(index, &chunk);
+	}
+	if (ferror(f))
+		err(EXIT_FAILURE, "getline %s", path);
+
+	free(line);
+	fclose(f);
+}
+
+// Prints the index of an image, and writes its chunks into dir if
+// it's given.
+static void do_index(const char image[static 1], const char *dir)
+{
+	static unsigned char buf[CHUNK_SIZE];
+	unsigned char hash[32];
+	char name[71], hex[65];
+	int fd, dir_fd = -1, chunk_fd;
+	off_t off = 0;
+	size_t len;
+
+	if ((fd = open(image, O_RDONLY | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", image);
+	if (dir && (dir_fd = open(dir, O_DIRECTORY | O_PATH | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", dir);
+
+	while ((len = read_full(fd, buf, sizeof buf, off))) {
+		digest(hash, buf, len);
+		sha256_hex(hash, hex);
+		if (printf("%s %zu\n", hex, len) < 0)
+			err(EXIT_FAILURE, "printf");
+		off += len;
+
+		if (dir_fd == -1)
+			continue;
+		chunk_name(name, hash);
+		chunk_fd = openat(dir_fd, name,
+		                  O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+		if (chunk_fd == -1) {
+			// Chunks that appear more than once are only written
+			// once.
+			if (errno == EEXIST)
+				continue;
+			err(EXIT_FAILURE, "open %s/%s", dir, name);
+		}
+		write_all(chunk_fd, buf, len);
+		if (close(chunk_fd) == -1)
+			err(EXIT_FAILURE, "close %s/%s", dir, name);
+	}
+
+	if (fflush(stdout) == EOF)
+		err(EXIT_FAILURE, "fflush");
+}
+
+// Reads a chunk from the directory of downloaded chunks, or failing
+// that from the seed image, and returns whether it was found.
+static bool read_chunk(unsigned char buf[static CHUNK_SIZE],
+                       const struct chunk chunk[static 1], int dir_fd,
+                       int seed_fd, const struct index seed[static 1])
+{
+	unsigned char hash[32];
+	struct chunk *found;
+	char name[71];
+	int fd;
+
+	chunk_name(name, chunk->digest);
+	if ((fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC)) != -1) {
+		if (read_full(fd, buf, CHUNK_SIZE, 0) != chunk->len)
+			errx(EXIT_FAILURE, "%s has the wrong length", name);
+		close(fd);
+	} else if (errno != ENOENT) {
+		err(EXIT_FAILURE, "open %s", name);
+	} else if (seed->len &&
+	           (found = bsearch(chunk, seed->chunks, seed->len,
+	                            sizeof *seed->chunks, compare_digest)) &&
+	           found->len == chunk->len) {
+		if (read_full(seed_fd, buf, chunk->len, found->off) != chunk->len)
+			errx(EXIT_FAILURE, "seed image is shorter than its index");
+	} else {
+		return false;
+	}
+
+	digest(hash, buf, chunk->len);
+	if (memcmp(hash, chunk->digest, 32))
+		errx(EXIT_FAILURE, "%s doesn't match its digest", name);
+	return true;
+}
+
+static void do_assemble(const char index_path[static 1], const char dir[static 1],
+                        const char out[static 1], const char max_size_arg[static 1],
+                        const char *seed_path, const char *seed_index_path)
+{
+	static unsigned char buf[CHUNK_SIZE];
+	struct index index = {}, seed = {};
+	int dir_fd, seed_fd = -1, out_fd;
+	unsigned long long max_size;
+	size_t missing = 0;
+	char *end;
+
+	errno = 0;
+	max_size = strtoull(max_size_arg, &end, 10);
+	if (errno || *end || *max_size_arg < '0' || *max_size_arg > '9')
+		errx(EXIT_FAILURE, "invalid maximum size %s", max_size_arg);
+
+	read_index(&index, index_path);
+	if (index.len && (unsigned long long)index.chunks[index.len - 1].off +
+	                 index.chunks[index.len - 1].len > max_size)
+		errx(EXIT_FAILURE, "%s is for an image bigger than %llu bytes",
+		     index_path, max_size);
+	if (seed_path) {
+		read_index(&seed, seed_index_path);
+		qsort(seed.chunks, seed.len, sizeof *seed.chunks, compare_digest);
+		if ((seed_fd = open(seed_path, O_RDONLY | O_CLOEXEC)) == -1)
+			err(EXIT_FAILURE, "open %s", seed_path);
+	}
+
+	if ((dir_fd = open(dir, O_DIRECTORY | O_PATH | O_CLOEXEC)) == -1)
+		err(EXIT_FAILURE, "open %s", dir);
+	if ((out_fd = open(out, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644)) == -1)
+		err(EXIT_FAILURE, "open %s", out);
+
+	for (size_t i = 0; i < index.len; i++) {
+		if (!read_chunk(buf, &index.chunks[i], dir_fd, seed_fd, &seed)) {
+			missing++;
+			continue;
+		}
+		if (!missing)
+			write_all(out_fd, buf, index.chunks[i].len);
+	}
+
+	if (missing) {
+		unlink(out);
+		errx(EXIT_FAILURE, "%zu chunks of %s are missing", missing, index_path);
+	}
+	if (close(out_fd) == -1)
+		err(EXIT_FAILURE, "close %s", out);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+		ex_usage();
+
+	if (!strcmp(argv[1], "index") && (argc == 3 || argc == 4))
+		do_index(argv[2], argv[3]);
+	else if (!strcmp(argv[1], "assemble") && (argc == 6 || argc == 8))
+		do_assemble(argv[2], argv[3], argv[4], argv[5],
+		            argc == 8 ? argv[6] : nullptr,
+		            argc == 8 ? argv[7] : nullptr);
+	else
+		ex_usage();
+}
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+//! Inflates the balloons of running VMs while the host is under
+//! memory pressure, and deflates them again once it has passed.
+//!
+//! Memory the guests have freed is already returned to the host by
+//! free page reporting, so this only has to step in when that isn't
+//! enough.  Guests deflate their balloons themselves if they run out
+//! of memory.
+
+use std::fs::{OpenOptions, read_dir};
+use std::io::{self, ErrorKind, Write};
+use std::os::fd::AsRawFd;
+use std::os::raw::{c_int, c_short, c_ulong};
+use std::process::exit;
+
+use miniserde::{Deserialize, Serialize, json};
+
+use start_vmm::{api_request, prog_name};
+
+const POLLPRI: c_short = 0x2;
+const POLLERR: c_short = 0x8;
+
+/// Notify us when tasks have been stalled waiting for memory for
+/// 150ms within any 1s window.
+const TRIGGER: &[u8] = b"some 150000 1000000\0";
+
+/// How long the host has to go without memory pressure before
+/// balloons are deflated a step.
+const RELAX_TIMEOUT_MS: c_int = 10_000;
+
+/// Balloons are resized by this fraction of the VM's memory at a time.
+const STEP_DIVISOR: u64 = 8;
+
+/// Balloons never take more than this fraction of the VM's memory.
+const MAX_DIVISOR: u64 = 2;
+
+#[repr(C)]
+struct PollFd {
+    fd: c_int,
+    events: c_short,
+    revents: c_short,
+}
+
+// SAFETY: declaration is compatible with C.
+unsafe extern "C" {
+    fn poll(fds: *mut PollFd, nfds: c_ulong, timeout: c_int) -> c_int;
+}
+
+#[derive(Deserialize)]
+struct BalloonInfo {
+    size: u64,
+}
+
+#[derive(Deserialize)]
+struct MemoryInfo {
+    size: u64,
+}
+
+#[derive(Deserialize)]
+struct ConfigInfo {
+    balloon: Option<BalloonInfo>,
+    memory: MemoryInfo,
+}
+
+#[derive(Deserialize)]
+struct Info {
+    config: ConfigInfo,
+    state: String,
+}
+
+#[derive(Serialize)]
+struct Resize {
+    desired_balloon: u64,
+}
+
+/// Returns the balloon size a VM should have after a pressure event
+/// (or the lack of one).
+fn balloon_target(current: u64, memory: u64, pressure: bool) -> u64 {
+    let step = memory / STEP_DIVISOR;
+
+    if pressure {
+        (current + step).min(memory / MAX_DIVISOR).max(current)
+    } else {
+        current.saturating_sub(step)
+    }
+}
+
+/// Resizes the balloon of every running VM, and returns whether any
+/// are left inflated.
+fn adjust_balloons(pressure: bool) -> Result<bool, String> {
+    let mut inflated = false;
+
+    let entries = match read_dir("/run/vm/by-id") {
+        Ok(entries) => entries,
+        Err(e) if e.kind() == ErrorKind::NotFound => return Ok(false),
+        Err(e) => return Err(format!("reading /run/vm/by-id: {e}")),
+    };
+
+    for entry in entries {
+        let entry = entry.map_err(|e| format!("iterating /run/vm/by-id: {e}"))?;
+        let vm_dir = entry.path();
+
+        // VMs that aren't running will fail to respond, and can be
+        // skipped.
+        let Ok(json) = api_request(&vm_dir, "vm.info", None) else {
+            continue;
+        };
+        let info: Info = match json::from_str(&json) {
+            Ok(info) => info,
+            Err(e) => {
+                eprintln!("{}: parsing vm.info for {vm_dir:?}: {e}", prog_name());
+                continue;
+            }
+        };
+        let Some(balloon) = info.config.balloon else {
+            continue;
+        };
+        if info.state != "Running" {
+            inflated |= balloon.size != 0;
+            continue;
+        }
+
+        let target = balloon_target(balloon.size, info.config.memory.size, pressure);
+        inflated |= target != 0;
+        if target == balloon.size {
+            continue;
+        }
+
+        let resize = json::to_string(&Resize {
+            desired_balloon: target,
+        });
+        if let Err(e) = api_request(&vm_dir, "vm.resize", Some(&resize)) {
+            eprintln!("{}: resizing balloon for {vm_dir:?}: {e}", prog_name());
+        }
+    }
+
+    Ok(inflated)
+}
+
+fn run() -> Result<(), String> {
+    let mut psi = OpenOptions::new()
+        .read(true)
+        .write(true)
+        .open("/proc/pressure/memory")
+        .map_err(|e| format!("opening /proc/pressure/memory: {e}"))?;
+    psi.write_all(TRIGGER)
+        .map_err(|e| format!("creating PSI trigger: {e}"))?;
+
+    let mut inflated = false;
+
+    loop {
+        let mut fd = PollFd {
+            fd: psi.as_raw_fd(),
+            events: POLLPRI,
+            revents: 0,
+        };
+
+        // Without any inflated balloons there's nothing to do until
+        // the next pressure event.
+        let timeout = if inflated { RELAX_TIMEOUT_MS } else { -1 };
+
+        // SAFETY: we pass a single valid pollfd.
+        let pressure = match unsafe { poll(&mut fd, 1, timeout) } {
+            -1 => {
+                let e = io::Error::last_os_error();
+                if e.kind() == ErrorKind::Interrupted {
+                    continue;
+                }
+                return Err(format!("polling PSI trigger: {e}"));
+            }
+            0 => false,
+            _ if fd.revents & POLLERR != 0 => return Err("PSI trigger was removed".to_string()),
+            _ => true,
+        };
+
+        inflated = adjust_balloons(pressure)?;
+    }
+}
+
+fn main() {
+    if let Err(e) = run() {
+        eprintln!("{}: {e}", prog_name());
+        exit(1);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const GIB: u64 = 1 << 30;
+
+    #[test]
+    fn inflate_steps() {
+        assert_eq!(balloon_target(0, GIB, true), GIB / 8);
+        assert_eq!(balloon_target(GIB / 8, GIB, true), GIB / 4);
+    }
+
+    #[test]
+    fn inflate_max() {
+        assert_eq!(balloon_target(GIB / 2 - 1, GIB, true), GIB / 2);
+        assert_eq!(balloon_target(GIB / 2, GIB, true), GIB / 2);
+    }
+
+    #[test]
+    fn inflate_never_deflates() {
+        // Set to more than the maximum by something else.
+        assert_eq!(balloon_target(GIB - 1, GIB, true), GIB - 1);
+    }
+
+    #[test]
+    fn deflate_steps() {
+        assert_eq!(balloon_target(GIB / 4, GIB, false), GIB / 8);
+        assert_eq!(balloon_target(GIB / 16, GIB, false), 0);
+        assert_eq!(balloon_target(0, GIB, false), 0);
+    }
+}
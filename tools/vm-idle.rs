@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+//! Pauses VMs that have been idle for longer than the number of
+//! seconds in their idle/timeout setting, and resumes them when they
+//! are used again.
+//!
+//! A VM is idle when neither its VMM, which includes its vCPUs and so
+//! any network traffic it handles, nor its services, which include
+//! the GPU device that the compositor sends input to, are using CPU
+//! time.  Before a VM is paused, its balloon is inflated so the host
+//! gets back the memory the guest isn't using.  Paused VMs are
+//! checked much more often than running ones, and resumed as soon as
+//! their services use any noticeable CPU time, e.g. because the user
+//! moved the pointer over one of their windows.
+//!
+//! vm-balloon also resizes balloons, so the balloon is only ever
+//! inflated here, never deflated below what vm-balloon asked for, and
+//! it's checked again just before pausing, in case vm-balloon deflated
+//! it in between.  When the VM is used again, the balloon is put back
+//! to how it was, unless vm-balloon has resized it since.
+
+use std::collections::HashMap;
+use std::ffi::OsString;
+use std::fs::{File, read_dir, read_to_string, remove_file};
+use std::io::ErrorKind;
+use std::path::Path;
+use std::process::exit;
+use std::thread::sleep;
+use std::time::{Duration, Instant};
+
+use miniserde::{Deserialize, Serialize, json};
+
+use start_vmm::{api_request, prog_name};
+
+/// How often running VMs are checked for activity.
+const INTERVAL: Duration = Duration::from_secs(10);
+
+/// How often VMs paused here are checked for activity, so that they're
+/// resumed before the user notices.
+const PAUSED_INTERVAL: Duration = Duration::from_millis(200);
+
+/// A running VM is active if its VMM or services use more than this
+/// fraction of a CPU between checks.
+const ACTIVE_DIVISOR: u64 = 100;
+
+/// A paused VM is active if its services use more than this much CPU
+/// time between checks.  The VMM is left out, because it still answers
+/// API requests, including ours, while the VM is paused.
+const PAUSED_ACTIVE_USEC: u64 = 1000;
+
+/// Balloons are inflated to this fraction of the VM's memory before
+/// the VM is paused.
+const RECLAIM_DIVISOR: u64 = 2;
+
+#[derive(Deserialize)]
+struct BalloonInfo {
+    size: u64,
+}
+
+#[derive(Deserialize)]
+struct MemoryInfo {
+    size: u64,
+}
+
+#[derive(Deserialize)]
+struct ConfigInfo {
+    balloon: Option<BalloonInfo>,
+    memory: MemoryInfo,
+}
+
+#[derive(Deserialize)]
+struct Info {
+    config: ConfigInfo,
+    state: String,
+}
+
+#[derive(Serialize)]
+struct Resize {
+    desired_balloon: u64,
+}
+
+#[derive(Debug, PartialEq)]
+enum Action {
+    None,
+    Reclaim,
+    Pause,
+    Resume,
+}
+
+struct Vm {
+    vmm_usec: u64,
+    services_usec: u64,
+    checked_at: Instant,
+    active_at: Instant,
+    reclaimed: bool,
+    /// The size of the balloon before it was inflated here.
+    balloon_before: u64,
+}
+
+/// Returns whether a VM used CPU time since it was last checked.
+fn is_active(vm: &Vm, vmm_usec: u64, services_usec: u64, paused: bool, now: Instant) -> bool {
+    let services = services_usec.saturating_sub(vm.services_usec);
+    if paused {
+        return services > PAUSED_ACTIVE_USEC;
+    }
+
+    let threshold = now.duration_since(vm.checked_at).as_micros() as u64 / ACTIVE_DIVISOR;
+    vmm_usec.saturating_sub(vm.vmm_usec) > threshold || services > threshold
+}
+
+/// Decides what to do with a VM, given whether it was active since
+/// the last check.
+fn action(
+    vm: &Vm,
+    state: &str,
+    active: bool,
+    paused_here: bool,
+    timeout: Duration,
+    now: Instant,
+) -> Action {
+    match state {
+        "Paused" if active && paused_here => Action::Resume,
+        "Running" if !active && now.duration_since(vm.active_at) >= timeout => {
+            if vm.reclaimed {
+                Action::Pause
+            } else {
+                Action::Reclaim
+            }
+        }
+        _ => Action::None,
+    }
+}
+
+fn cpu_usage_usec(cgroup: &Path) -> Option<u64> {
+    read_to_string(cgroup.join("cpu.stat"))
+        .ok()?
+        .lines()
+        .find_map(|line| line.strip_prefix("usage_usec "))?
+        .parse()
+        .ok()
+}
+
+/// Returns a VM's idle timeout, or None if it shouldn't be paused.
+fn idle_timeout(vm_dir: &Path) -> Result<Option<Duration>, String> {
+    let path = vm_dir.join("config/idle/timeout");
+    match read_to_string(&path) {
+        Ok(timeout) => timeout
+            .trim_end_matches('\n')
+            .parse()
+            .map(|secs| Some(Duration::from_secs(secs)))
+            .map_err(|e| format!("{path:?}: {e}")),
+        Err(e) if e.kind() == ErrorKind::NotFound => Ok(None),
+        Err(e) => Err(format!("reading {path:?}: {e}")),
+    }
+}
+
+fn resize_balloon(vm_dir: &Path, desired_balloon: u64) -> Result<(), String> {
+    let resize = json::to_string(&Resize { desired_balloon });
+    api_request(vm_dir, "vm.resize", Some(&resize)).map(drop)
+}
+
+/// Returns the size a balloon should be inflated to before the VM is
+/// paused.
+fn reclaim_target(current: u64, memory: u64) -> u64 {
+    current.max(memory / RECLAIM_DIVISOR)
+}
+
+fn check_vm(id: &OsString, vms: &mut HashMap<OsString, Vm>, now: Instant) -> Result<(), String> {
+    let vm_dir = Path::new("/run/vm/by-id").join(id);
+
+    // Only VMs paused here are resumed here, so that VMs paused for
+    // other reasons (e.g. waiting in the warm pool) stay paused.  This
+    // is recorded in the VM's directory so it survives restarts.
+    let paused_path = vm_dir.join("idle-paused");
+    let paused_here = paused_path.exists();
+
+    // Running VMs are only checked every INTERVAL.
+    if !paused_here
+        && let Some(vm) = vms.get(id)
+        && now.duration_since(vm.checked_at) < INTERVAL
+    {
+        return Ok(());
+    }
+
+    let Some(timeout) = idle_timeout(&vm_dir)? else {
+        return Ok(());
+    };
+
+    let cgroup = Path::new("/sys/fs/cgroup/vm").join(id);
+    let (Some(vmm_usec), Some(services_usec)) = (
+        cpu_usage_usec(&cgroup.join("vmm")),
+        cpu_usage_usec(&cgroup.join("services")),
+    ) else {
+        return Ok(());
+    };
+
+    let vm = vms.entry(id.clone()).or_insert(Vm {
+        vmm_usec,
+        services_usec,
+        checked_at: now,
+        active_at: now,
+        reclaimed: false,
+        balloon_before: 0,
+    });
+
+    let active = is_active(vm, vmm_usec, services_usec, paused_here, now);
+    vm.vmm_usec = vmm_usec;
+    vm.services_usec = services_usec;
+
+    // Between the frequent checks of a paused VM, there's nothing to do
+    // unless it's been used, but it's still asked for its state every
+    // INTERVAL in case something else resumed it.
+    if paused_here && !active && now.duration_since(vm.checked_at) < INTERVAL {
+        return Ok(());
+    }
+    vm.checked_at = now;
+
+    // VMs that aren't running will fail to respond, and can be
+    // skipped.
+    let Ok(json) = api_request(&vm_dir, "vm.info", None) else {
+        return Ok(());
+    };
+    let info: Info = json::from_str(&json).map_err(|e| format!("parsing vm.info: {e}"))?;
+
+    if paused_here && info.state == "Running" {
+        // Resumed by something else.
+        remove_file(&paused_path).map_err(|e| format!("removing {paused_path:?}: {e}"))?;
+    }
+
+    match action(vm, &info.state, active, paused_here, timeout, now) {
+        Action::None => {}
+        Action::Reclaim => {
+            vm.reclaimed = true;
+            if let Some(balloon) = &info.config.balloon {
+                vm.balloon_before = balloon.size;
+                let target = reclaim_target(balloon.size, info.config.memory.size);
+                if target != balloon.size {
+                    resize_balloon(&vm_dir, target)?;
+                }
+            }
+        }
+        Action::Pause => {
+            // vm-balloon might have deflated the balloon since it was
+            // inflated here.
+            if let Some(balloon) = &info.config.balloon {
+                let target = reclaim_target(balloon.size, info.config.memory.size);
+                if target != balloon.size {
+                    resize_balloon(&vm_dir, target)?;
+                }
+            }
+            File::create(&paused_path).map_err(|e| format!("creating {paused_path:?}: {e}"))?;
+            api_request(&vm_dir, "vm.pause", None)?;
+        }
+        Action::Resume => {
+            api_request(&vm_dir, "vm.resume", None)?;
+            remove_file(&paused_path).map_err(|e| format!("removing {paused_path:?}: {e}"))?;
+        }
+    }
+
+    if active {
+        // Give back the memory taken before pausing, whether the VM
+        // was resumed here or by something else, unless vm-balloon
+        // has resized the balloon since.
+        if vm.reclaimed
+            && let Some(balloon) = &info.config.balloon
+            && balloon.size != vm.balloon_before
+            && balloon.size == reclaim_target(vm.balloon_before, info.config.memory.size)
+        {
+            resize_balloon(&vm_dir, vm.balloon_before)?;
+        }
+        vm.active_at = now;
+        vm.reclaimed = false;
+    }
+
+    Ok(())
+}
+
+fn run() -> Result<(), String> {
+    let mut vms = HashMap::new();
+
+    loop {
+        let now = Instant::now();
+
+        let entries = match read_dir("/run/vm/by-id") {
+            Ok(entries) => entries,
+            Err(e) if e.kind() == ErrorKind::NotFound => {
+                sleep(PAUSED_INTERVAL);
+                continue;
+            }
+            Err(e) => return Err(format!("reading /run/vm/by-id: {e}")),
+        };
+
+        let mut ids = vec![];
+        for entry in entries {
+            let entry = entry.map_err(|e| format!("iterating /run/vm/by-id: {e}"))?;
+            ids.push(entry.file_name());
+        }
+
+        // Forget VMs that no longer exist.
+        vms.retain(|id, _| ids.contains(id));
+
+        for id in &ids {
+            if let Err(e) = check_vm(id, &mut vms, now) {
+                eprintln!("{}: {id:?}: {e}", prog_name());
+            }
+        }
+
+        sleep(PAUSED_INTERVAL);
+    }
+}
+
+fn main() {
+    if let Err(e) = run() {
+        eprintln!("{}: {e}", prog_name());
+        exit(1);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const TIMEOUT: Duration = Duration::from_secs(300);
+
+    fn idle_vm(idle: Duration, reclaimed: bool) -> (Vm, Instant) {
+        let active_at = Instant::now();
+        let vm = Vm {
+            vmm_usec: 0,
+            services_usec: 0,
+            checked_at: active_at,
+            active_at,
+            reclaimed,
+            balloon_before: 0,
+        };
+        (vm, active_at + idle)
+    }
+
+    #[test]
+    fn not_idle_long_enough() {
+        let (vm, now) = idle_vm(TIMEOUT / 2, false);
+        assert_eq!(
+            action(&vm, "Running", false, false, TIMEOUT, now),
+            Action::None
+        );
+    }
+
+    #[test]
+    fn reclaim_then_pause() {
+        let (vm, now) = idle_vm(TIMEOUT, false);
+        assert_eq!(
+            action(&vm, "Running", false, false, TIMEOUT, now),
+            Action::Reclaim
+        );
+        let (vm, now) = idle_vm(TIMEOUT, true);
+        assert_eq!(
+            action(&vm, "Running", false, false, TIMEOUT, now),
+            Action::Pause
+        );
+    }
+
+    #[test]
+    fn active_not_paused() {
+        let (vm, now) = idle_vm(TIMEOUT * 2, true);
+        assert_eq!(
+            action(&vm, "Running", true, false, TIMEOUT, now),
+            Action::None
+        );
+    }
+
+    #[test]
+    fn resume() {
+        let (vm, now) = idle_vm(TIMEOUT * 2, true);
+        assert_eq!(
+            action(&vm, "Paused", true, true, TIMEOUT, now),
+            Action::Resume
+        );
+        assert_eq!(
+            action(&vm, "Paused", false, true, TIMEOUT, now),
+            Action::None
+        );
+        // Paused by something else.
+        assert_eq!(
+            action(&vm, "Paused", true, false, TIMEOUT, now),
+            Action::None
+        );
+    }
+
+    #[test]
+    fn paused_threshold() {
+        let (vm, now) = idle_vm(INTERVAL, true);
+        // A few milliseconds of the services' time, like a pointer
+        // event forwarded to the GPU device, is far below what makes a
+        // running VM active, but is enough to resume a paused one.
+        assert!(!is_active(&vm, 0, 5000, false, now));
+        assert!(is_active(&vm, 0, 5000, true, now));
+        // The VMM answering API requests doesn't count.
+        assert!(!is_active(&vm, 100_000, 0, true, now));
+        assert!(!is_active(&vm, 0, PAUSED_ACTIVE_USEC, true, now));
+    }
+
+    #[test]
+    fn running_threshold() {
+        let (vm, now) = idle_vm(INTERVAL, false);
+        assert!(!is_active(&vm, 50_000, 50_000, false, now));
+        assert!(is_active(&vm, 200_000, 0, false, now));
+        assert!(is_active(&vm, 0, 200_000, false, now));
+    }
+
+    #[test]
+    fn reclaim_never_deflates() {
+        assert_eq!(reclaim_target(0, 1 << 30), 1 << 29);
+        assert_eq!(reclaim_target(3 << 28, 1 << 30), 3 << 28);
+    }
+}
@@ -0,0 +1,473 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+//! Keeps track of the state of every VM, so that it can be queried
+//! without asking each VMM in turn.
+//!
+//! State changes are learned from two places: the event monitor
+//! stream each Cloud Hypervisor process writes to
+//! /run/vm/by-id/ID/events, and the supervision events s6 sends for
+//! the VM's vmm service instance, if it has one.  Each connection to
+//! the listening socket on stdin is sent one "ID STATE" line per VM.
+
+use std::collections::{BTreeMap, HashMap};
+use std::ffi::{CString, OsStr, OsString};
+use std::fs::{File, OpenOptions, read_dir, remove_file};
+use std::io::{self, BufReader, ErrorKind, Read, Seek, SeekFrom, Write};
+use std::os::raw::{c_char, c_int};
+use std::os::unix::net::UnixListener;
+use std::os::unix::prelude::*;
+use std::path::Path;
+use std::process::exit;
+use std::sync::{Arc, Mutex};
+use std::thread::{sleep, spawn};
+use std::time::Duration;
+
+use miniserde::{Deserialize, json};
+
+use start_vmm::{api_request, prog_name};
+
+const IN_MODIFY: u32 = 0x2;
+const IN_MOVED_FROM: u32 = 0x40;
+const IN_MOVED_TO: u32 = 0x80;
+const IN_CREATE: u32 = 0x100;
+const IN_DELETE: u32 = 0x200;
+const IN_ONLYDIR: u32 = 0x1000000;
+const IN_IGNORED: u32 = 0x8000;
+
+const O_NONBLOCK: c_int = 0o4000;
+const O_CLOEXEC: c_int = 0o2000000;
+
+const BY_ID: &str = "/run/vm/by-id";
+const VMM_INSTANCES: &str = "/run/service/vmm/instance";
+
+// s6-supervise writes its events to every FIFO in the service's event
+// directory with a name starting with "ftrig1".
+const FIFO_NAME: &str = "ftrig1vm-registry";
+
+// SAFETY: declarations are compatible with C.
+unsafe extern "C" {
+    fn inotify_init1(flags: c_int) -> c_int;
+    fn inotify_add_watch(fd: c_int, pathname: *const c_char, mask: u32) -> c_int;
+    fn mkfifo(pathname: *const c_char, mode: u32) -> c_int;
+}
+
+type States = Arc<Mutex<BTreeMap<OsString, &'static str>>>;
+
+fn set_state(states: &States, id: &OsStr, state: &'static str) {
+    states.lock().unwrap().insert(id.to_owned(), state);
+}
+
+/// Normalizes a state reported by Cloud Hypervisor.
+fn vmm_state(state: &str) -> &'static str {
+    match state {
+        "Created" => "Created",
+        "Running" => "Running",
+        "Paused" => "Paused",
+        "Shutdown" => "Shutdown",
+        "BreakPoint" => "BreakPoint",
+        _ => "Unknown",
+    }
+}
+
+fn query_state(id: &OsStr) -> &'static str {
+    #[derive(Deserialize)]
+    struct Info {
+        state: String,
+    }
+
+    // If there's no VMM listening, there's no VM.
+    let Ok(json) = api_request(&Path::new(BY_ID).join(id), "vm.info", None) else {
+        return "Stopped";
+    };
+
+    match json::from_str(&json) {
+        Ok(Info { state }) => vmm_state(&state),
+        Err(_) => "Unknown",
+    }
+}
+
+/// Returns the state a VM is in after a Cloud Hypervisor event.
+fn event_state(source: &str, event: &str) -> Option<&'static str> {
+    match (source, event) {
+        ("vm", "booted" | "resumed" | "restored" | "rebooted") => Some("Running"),
+        ("vm", "paused") => Some("Paused"),
+        ("vm", "shutdown") => Some("Shutdown"),
+        ("vm", "deleted") | ("vmm", "shutdown") => Some("Stopped"),
+        _ => None,
+    }
+}
+
+/// Removes each complete top-level JSON object from the start of buf,
+/// and returns them.  Cloud Hypervisor pretty-prints its events, so
+/// they can't be split on newlines.
+fn take_objects(buf: &mut Vec<u8>) -> Vec<String> {
+    let mut objects = vec![];
+    let mut depth = 0_u32;
+    let (mut start, mut in_string, mut escaped) = (0, false, false);
+    let mut consumed = 0;
+
+    for (i, &b) in buf.iter().enumerate() {
+        if in_string {
+            match b {
+                _ if escaped => escaped = false,
+                b'\\' => escaped = true,
+                b'"' => in_string = false,
+                _ => {}
+            }
+            continue;
+        }
+
+        match b {
+            b'"' => in_string = true,
+            b'{' => {
+                if depth == 0 {
+                    start = i;
+                }
+                depth += 1;
+            }
+            b'}' if depth > 0 => {
+                depth -= 1;
+                if depth == 0 {
+                    objects.push(String::from_utf8_lossy(&buf[start..=i]).into_owned());
+                    consumed = i + 1;
+                }
+            }
+            _ if depth == 0 => consumed = i + 1,
+            _ => {}
+        }
+    }
+
+    buf.drain(..consumed);
+    objects
+}
+
+struct EventLog {
+    id: OsString,
+    file: Option<File>,
+    buf: Vec<u8>,
+}
+
+impl EventLog {
+    fn open(&mut self, skip_existing: bool) {
+        let path = Path::new(BY_ID).join(&self.id).join("events");
+        self.file = File::open(path).ok();
+        if skip_existing && let Some(file) = &mut self.file {
+            let _ = file.seek(SeekFrom::End(0));
+        }
+    }
+
+    fn read(&mut self, states: &States) {
+        if self.file.is_none() {
+            self.open(false);
+        }
+        let Some(file) = &mut self.file else {
+            return;
+        };
+
+        if let Err(e) = file.read_to_end(&mut self.buf) {
+            eprintln!("{}: reading events for {:?}: {e}", prog_name(), self.id);
+            return;
+        }
+
+        #[derive(Deserialize)]
+        struct Event {
+            source: String,
+            event: String,
+        }
+
+        for object in take_objects(&mut self.buf) {
+            let Ok(Event { source, event }) = json::from_str(&object) else {
+                continue;
+            };
+            if let Some(state) = event_state(&source, &event) {
+                set_state(states, &self.id, state);
+            }
+        }
+    }
+}
+
+/// Creates a FIFO, and returns its read end and a write end that
+/// has to be kept open for as long as the FIFO is read from.
+fn open_fifo(path: &Path) -> io::Result<(File, File)> {
+    let _ = remove_file(path);
+
+    let c_path = CString::new(path.as_os_str().as_bytes()).unwrap();
+    // SAFETY: c_path is a valid NUL-terminated string.
+    if unsafe { mkfifo(c_path.as_ptr(), 0o600) } == -1 {
+        return Err(io::Error::last_os_error());
+    }
+
+    // Opening the read end of a FIFO blocks until there's a writer,
+    // unless it's non-blocking, and we want blocking reads.  Keep a
+    // writer of our own open too, so reads block instead of reaching
+    // EOF between s6-supervise's writes.
+    let nonblocking = OpenOptions::new()
+        .read(true)
+        .custom_flags(O_NONBLOCK)
+        .open(path)?;
+    let writer = OpenOptions::new().write(true).open(path)?;
+    let reader = File::open(path)?;
+    drop(nonblocking);
+    Ok((reader, writer))
+}
+
+fn watch_supervisor(states: States, id: OsString) {
+    let fifo_path = Path::new(VMM_INSTANCES)
+        .join(&id)
+        .join("event")
+        .join(FIFO_NAME);
+
+    // The instance's event directory might not have been created yet.
+    let mut fifo = None;
+    for _ in 0..50 {
+        match open_fifo(&fifo_path) {
+            Ok(f) => {
+                fifo = Some(f);
+                break;
+            }
+            Err(e) if e.kind() == ErrorKind::NotFound => sleep(Duration::from_millis(100)),
+            Err(e) => {
+                eprintln!("{}: creating {fifo_path:?}: {e}", prog_name());
+                return;
+            }
+        }
+    }
+    let Some((fifo, writer)) = fifo else {
+        eprintln!("{}: {fifo_path:?} never appeared", prog_name());
+        return;
+    };
+
+    // Events sent before the FIFO existed were missed.
+    set_state(&states, &id, query_state(&id));
+
+    for byte in BufReader::new(fifo).bytes() {
+        match byte {
+            // The VMM has created the VM and notified readiness.
+            Ok(b'U') => set_state(&states, &id, "Created"),
+            Ok(b'd') => set_state(&states, &id, "Stopped"),
+            // s6-supervise is exiting, so the instance has been deleted.
+            Ok(b'x') => break,
+            Ok(_) => {}
+            Err(e) => {
+                eprintln!("{}: reading {fifo_path:?}: {e}", prog_name());
+                break;
+            }
+        }
+    }
+
+    drop(writer);
+    let _ = remove_file(&fifo_path);
+}
+
+fn add_watch(inotify: &File, path: &Path, mask: u32) -> Result<c_int, String> {
+    let c_path = CString::new(path.as_os_str().as_bytes()).unwrap();
+    // SAFETY: inotify is an inotify FD, and c_path is a valid
+    // NUL-terminated string.
+    let wd = unsafe { inotify_add_watch(inotify.as_raw_fd(), c_path.as_ptr(), mask) };
+    if wd == -1 {
+        let e = io::Error::last_os_error();
+        return Err(format!("watching {path:?}: {e}"));
+    }
+    Ok(wd)
+}
+
+struct Registry {
+    states: States,
+    inotify: File,
+    by_id_wd: c_int,
+    instances_wd: c_int,
+    vms: HashMap<c_int, EventLog>,
+}
+
+impl Registry {
+    fn add_vm(&mut self, id: &OsStr, existing: bool) {
+        let dir = Path::new(BY_ID).join(id);
+        let wd = match add_watch(&self.inotify, &dir, IN_CREATE | IN_MODIFY | IN_ONLYDIR) {
+            Ok(wd) => wd,
+            Err(e) => {
+                eprintln!("{}: {e}", prog_name());
+                return;
+            }
+        };
+
+        let mut log = EventLog {
+            id: id.to_owned(),
+            file: None,
+            buf: vec![],
+        };
+
+        // Only the current state matters for a VM that was already
+        // running, so skip its past events and ask the VMM instead.
+        log.open(existing);
+        let state = if existing { query_state(id) } else { "Stopped" };
+        set_state(&self.states, id, state);
+
+        self.vms.insert(wd, log);
+    }
+
+    fn remove_vm(&mut self, wd: c_int) {
+        if let Some(log) = self.vms.remove(&wd) {
+            self.states.lock().unwrap().remove(&log.id);
+        }
+    }
+
+    fn add_instance(&self, id: &OsStr) {
+        let states = self.states.clone();
+        let id = id.to_owned();
+        spawn(move || watch_supervisor(states, id));
+    }
+
+    fn handle_event(&mut self, wd: c_int, mask: u32, name: &OsStr) {
+        if wd == self.by_id_wd {
+            if mask & (IN_CREATE | IN_MOVED_TO) != 0 {
+                self.add_vm(name, false);
+            }
+        } else if wd == self.instances_wd {
+            if mask & (IN_CREATE | IN_MOVED_TO) != 0 {
+                self.add_instance(name);
+            }
+        } else if mask & IN_IGNORED != 0 {
+            // The VM's directory has been deleted.
+            self.remove_vm(wd);
+        } else if name == "events"
+            && let Some(log) = self.vms.get_mut(&wd)
+        {
+            // run-vmm replaces the log each time the VMM starts.
+            if mask & IN_CREATE != 0 {
+                log.buf.clear();
+                log.open(false);
+            }
+            log.read(&self.states);
+        }
+    }
+
+    fn run(&mut self) -> Result<(), String> {
+        let mut buf = [0; 4096];
+        loop {
+            let len = match self.inotify.read(&mut buf) {
+                Ok(len) => len,
+                Err(e) if e.kind() == ErrorKind::Interrupted => continue,
+                Err(e) => return Err(format!("reading inotify events: {e}")),
+            };
+
+            // struct inotify_event is a 16-byte header followed by
+            // the NUL-padded name.
+            let mut rest = &buf[..len];
+            while rest.len() >= 16 {
+                let wd = c_int::from_ne_bytes(rest[0..4].try_into().unwrap());
+                let mask = u32::from_ne_bytes(rest[4..8].try_into().unwrap());
+                let name_len = u32::from_ne_bytes(rest[12..16].try_into().unwrap()) as usize;
+                let name = &rest[16..16 + name_len];
+                let name = &name[..name.iter().position(|&b| b == 0).unwrap_or(name.len())];
+
+                self.handle_event(wd, mask, OsStr::from_bytes(name));
+                rest = &rest[16 + name_len..];
+            }
+        }
+    }
+}
+
+fn serve(listener: UnixListener, states: States) {
+    for conn in listener.incoming() {
+        let mut conn = match conn {
+            Ok(conn) => conn,
+            Err(e) => {
+                eprintln!("{}: accepting connection: {e}", prog_name());
+                continue;
+            }
+        };
+
+        let mut out = vec![];
+        for (id, state) in states.lock().unwrap().iter() {
+            out.extend_from_slice(id.as_bytes());
+            out.push(b' ');
+            out.extend_from_slice(state.as_bytes());
+            out.push(b'\n');
+        }
+
+        if let Err(e) = conn.write_all(&out) {
+            eprintln!("{}: writing response: {e}", prog_name());
+        }
+    }
+}
+
+/// # Safety
+///
+/// Takes ownership of the file descriptors for the listening socket and
+/// readiness notification, so can only be called once.
+unsafe fn run() -> Result<(), String> {
+    // SAFETY: no file descriptors are owned yet.
+    let inotify = unsafe { inotify_init1(O_CLOEXEC) };
+    if inotify == -1 {
+        let e = io::Error::last_os_error();
+        return Err(format!("inotify_init1: {e}"));
+    }
+    // SAFETY: we just created this FD.
+    let inotify = unsafe { File::from_raw_fd(inotify) };
+
+    let dir_events = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    let mut registry = Registry {
+        states: Default::default(),
+        by_id_wd: add_watch(&inotify, Path::new(BY_ID), dir_events | IN_ONLYDIR)?,
+        instances_wd: add_watch(&inotify, Path::new(VMM_INSTANCES), dir_events)?,
+        inotify,
+        vms: HashMap::new(),
+    };
+
+    for (dir, instances) in [(BY_ID, false), (VMM_INSTANCES, true)] {
+        for entry in read_dir(dir).map_err(|e| format!("reading {dir}: {e}"))? {
+            let entry = entry.map_err(|e| format!("iterating {dir}: {e}"))?;
+            if instances {
+                registry.add_instance(&entry.file_name());
+            } else {
+                registry.add_vm(&entry.file_name(), true);
+            }
+        }
+    }
+
+    // SAFETY: the listening socket is passed to us on stdin.
+    let listener = unsafe { UnixListener::from_raw_fd(0) };
+    let states = registry.states.clone();
+    spawn(move || serve(listener, states));
+
+    // Only notify readiness once every existing VM is known, so that
+    // clients don't get an empty list.
+    // SAFETY: invoker promises this FD is valid.
+    let mut ready = unsafe { File::from_raw_fd(3) };
+    writeln!(ready).map_err(|e| format!("notifying readiness: {e}"))?;
+    drop(ready);
+
+    registry.run()
+}
+
+fn main() {
+    if let Err(e) = unsafe { run() } {
+        eprintln!("{}: {e}", prog_name());
+        exit(1);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn take_objects_partial() {
+        let mut buf =
+            b"{\n  \"source\": \"vm\",\n  \"event\": \"booted\"\n}\n\n{\n  \"source\": \"v"
+                .to_vec();
+        let objects = take_objects(&mut buf);
+        assert_eq!(objects.len(), 1);
+        assert!(objects[0].contains("booted"));
+        assert_eq!(buf, b"{\n  \"source\": \"v");
+    }
+
+    #[test]
+    fn take_objects_braces_in_strings() {
+        let mut buf = br#"{"source":"vm","event":"}{\"","properties":{"a":"b"}}"#.to_vec();
+        let objects = take_objects(&mut buf);
+        assert_eq!(objects.len(), 1);
+        assert!(buf.is_empty());
+    }
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: EUPL-1.2+
+// SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+//! Prints the resource usage and pressure of each VM's cgroup.
+
+use std::ffi::OsStr;
+use std::fs::{read_dir, read_to_string};
+use std::io::{self, Write, stdout};
+use std::os::unix::prelude::*;
+use std::path::Path;
+use std::process::exit;
+
+use start_vmm::prog_name;
+
+struct Stats {
+    cpu_usec: Option<u64>,
+    memory: Option<u64>,
+    cpu_pressure: Option<f64>,
+    memory_pressure: Option<f64>,
+    io_pressure: Option<f64>,
+}
+
+/// Returns the value of key in a flat keyed file, like cpu.stat.
+fn keyed_value(contents: &str, key: &str) -> Option<u64> {
+    contents
+        .lines()
+        .filter_map(|line| line.split_once(' '))
+        .find(|(k, _)| *k == key)
+        .and_then(|(_, v)| v.parse().ok())
+}
+
+/// Returns the percentage of the last 10 seconds in which some tasks
+/// were stalled, from a PSI file.
+fn some_avg10(contents: &str) -> Option<f64> {
+    contents
+        .lines()
+        .find_map(|line| line.strip_prefix("some "))?
+        .split(' ')
+        .find_map(|field| field.strip_prefix("avg10="))?
+        .parse()
+        .ok()
+}
+
+fn read_stats(cgroup: &Path) -> Stats {
+    let read = |name| read_to_string(cgroup.join(name)).ok();
+
+    Stats {
+        cpu_usec: read("cpu.stat").and_then(|s| keyed_value(&s, "usage_usec")),
+        memory: read("memory.current").and_then(|s| s.trim_end().parse().ok()),
+        cpu_pressure: read("cpu.pressure").and_then(|s| some_avg10(&s)),
+        memory_pressure: read("memory.pressure").and_then(|s| some_avg10(&s)),
+        io_pressure: read("io.pressure").and_then(|s| some_avg10(&s)),
+    }
+}
+
+fn write_stats(mut out: impl Write, id: &OsStr, stats: &Stats) -> io::Result<()> {
+    out.write_all(id.as_bytes())?;
+
+    match stats.cpu_usec {
+        Some(usec) => write!(out, " {:>10.1}", usec as f64 / 1e6)?,
+        None => write!(out, " {:>10}", "-")?,
+    }
+    match stats.memory {
+        Some(bytes) => write!(out, " {:>8}", bytes >> 20)?,
+        None => write!(out, " {:>8}", "-")?,
+    }
+    for pressure in [stats.cpu_pressure, stats.memory_pressure, stats.io_pressure] {
+        match pressure {
+            Some(pressure) => write!(out, " {pressure:>6.2}")?,
+            None => write!(out, " {:>6}", "-")?,
+        }
+    }
+
+    writeln!(out)
+}
+
+fn run() -> Result<(), String> {
+    let mut ids = vec![];
+    for entry in read_dir("/run/vm/by-id").map_err(|e| format!("reading /run/vm/by-id: {e}"))? {
+        let entry = entry.map_err(|e| format!("iterating /run/vm/by-id: {e}"))?;
+        ids.push(entry.file_name());
+    }
+    ids.sort();
+
+    let mut stdout = stdout();
+
+    writeln!(
+        stdout,
+        "{:<6} {:>10} {:>8} {:>6} {:>6} {:>6}",
+        "ID", "CPU(s)", "MEM(MiB)", "CPU%", "MEM%", "IO%"
+    )
+    .map_err(|e| format!("writing output: {e}"))?;
+
+    for id in ids {
+        let stats = read_stats(&Path::new("/sys/fs/cgroup/vm").join(&id));
+        write_stats(&mut stdout, &id, &stats).map_err(|e| format!("writing output: {e}"))?;
+    }
+
+    Ok(())
+}
+
+fn main() {
+    if let Err(e) = run() {
+        eprintln!("{}: {}", prog_name(), e);
+        exit(1);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn cpu_stat() {
+        let stat = "usage_usec 1500000\nuser_usec 1000000\nsystem_usec 500000\n";
+        assert_eq!(keyed_value(stat, "usage_usec"), Some(1500000));
+        assert_eq!(keyed_value(stat, "nr_periods"), None);
+    }
+
+    #[test]
+    fn pressure() {
+        let psi = "some avg10=1.25 avg60=0.50 avg300=0.10 total=12345\n\
+                   full avg10=0.75 avg60=0.25 avg300=0.05 total=6789\n";
+        assert_eq!(some_avg10(psi), Some(1.25));
+        assert_eq!(some_avg10(""), None);
+    }
+}
@@ -14,10 +14,13 @@ pkgs.pkgsStatic.callPackage (
 
 { lib, runCommand, writeClosure, erofs-utils }:
 
-{ run, type, providers ? {}, sharedDirs ? {} }:
+{ run, type, providers ? {}, sharedDirs ? {}, cpus ? {}, idle ? {}, memory ? {}
+, virtiofs ? {} }:
 
 let
-  inherit (lib) any attrValues concatLists hasInfix mapAttrsToList;
+  inherit (lib)
+    any attrValues concatLists concatMapAttrs hasInfix isBool mapAttrs'
+    mapAttrsToList nameValuePair;
 in
 
 assert !(any (hasInfix "\n") (concatLists (attrValues providers)));
@@ -28,19 +31,37 @@ runCommand "spectrum-vm" {
   providerDirs = concatLists
     (mapAttrsToList (kind: map (vm: "${kind}/${vm}")) providers);
 
+  # Settings for start-vmm, vm-idle, and virtiofsd, each written to a
+  # file named for it.
+  settings = concatMapAttrs (dir: mapAttrs' (name: value:
+    nameValuePair "${dir}/${name}"
+      (if isBool value then (if value then "on" else "off") else toString value)
+  )) { inherit cpus idle memory virtiofs; };
+
   __structuredAttrs = true;
   unsafeDiscardReferences = { out = true; };
   dontFixup = true;
 } ''
-  mkdir -p $out/{blk,fs,providers}
+  mkdir -p $out/{blk,fs,pmem,providers} store
+  comm -23 <(sort ${writeClosure [ run ]}) \
+      <(sort ${writeClosure [ basePaths ]}) |
+      xargs -rd '\n' cp -rvt store
+
+  # The guest overlays this onto its own store.  Reading it from a
+  # disk is much faster than looking up every file over virtiofs.
+  mkfs.erofs -x-1 -b4096 -zlz4hc --all-root "$out/blk/store.img" store
+
   pushd "$out"
 
   echo ${type} > fs/type
   ln -s ${run} fs/run
-  mkdir -p fs${builtins.storeDir}
-  comm -23 <(sort ${writeClosure [ run ]}) \
-      <(sort ${writeClosure [ basePaths ]}) |
-      xargs -rd '\n' cp -rvt fs${builtins.storeDir}
+  # Tells the guest to wait for the store disk.
+  touch fs/store
+
+  for setting in "''${!settings[@]}"; do
+    mkdir -p -- "$(dirname -- "$setting")"
+    printf '%s\n' "''${settings[$setting]}" > "$setting"
+  done
 
   if (( ''${#providerDirs} != 0 )); then
     pushd providers
@@ -53,7 +74,7 @@ runCommand "spectrum-vm" {
 
   popd
 
-  ln -s /usr/lib/spectrum/img/appvm/blk/root.img "$out/blk"
+  ln -s /usr/lib/spectrum/img/appvm/pmem/root.img "$out/pmem"
   ln -s /usr/lib/spectrum/img/appvm/vmlinux "$out"
 ''
 ) {}
@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+# Measures read throughput and latency of /dev/vda, which the img/app
+# development shell attaches as a disk containing the root filesystem.
+# See Documentation/doc/development/benchmarking.adoc.
+
+import ../../lib/call-package.nix (
+{ callSpectrumPackage, writeScript, fio }:
+
+callSpectrumPackage ../make-vm.nix {} {
+  type = "nix";
+  run = writeScript "run-disk-benchmark" ''
+    #!/bin/execlineb -P
+    foreground {
+      ${fio}/bin/fio --name=seqread --filename=/dev/vda --readonly
+        --direct=1 --ioengine=libaio --rw=read --bs=1M --iodepth=8
+        --runtime=20 --time_based
+    }
+    ${fio}/bin/fio --name=randread --filename=/dev/vda --readonly
+      --direct=1 --ioengine=libaio --rw=randread --bs=4k --iodepth=32
+      --numjobs=4 --group_reporting --runtime=20 --time_based
+  '';
+}) (_: {})
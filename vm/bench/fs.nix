@@ -0,0 +1,38 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+# Measures metadata and read performance of the VM's virtio-fs
+# filesystem, in the VM's disk-backed directory.
+# See Documentation/doc/development/benchmarking.adoc.
+
+import ../../lib/call-package.nix (
+{ callSpectrumPackage, writeScript, fio
+, virtiofs ? {}
+}:
+
+callSpectrumPackage ../make-vm.nix {} {
+  inherit virtiofs;
+  type = "nix";
+  run = writeScript "run-fs-benchmark" ''
+    #!/bin/execlineb -P
+    define dir /host/disk/home/fs-benchmark
+    if { mkdir -p $dir }
+
+    # Repeatedly stats many small files from several threads, which
+    # is dominated by round trips to virtiofsd.
+    foreground {
+      ${fio}/bin/fio --name=stat --directory=$dir
+        --ioengine=filestat --nrfiles=1000 --filesize=4k --numjobs=4
+        --group_reporting --runtime=20 --time_based
+    }
+    foreground {
+      ${fio}/bin/fio --name=seqread --directory=$dir
+        --rw=read --bs=1M --size=1G
+    }
+    foreground {
+      ${fio}/bin/fio --name=randread --directory=$dir
+        --rw=randread --bs=4k --size=256M --numjobs=4 --group_reporting
+    }
+    rm -rf $dir
+  '';
+}) (_: {})
@@ -0,0 +1,35 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 Spectrum contributors
+
+# Measures guest memory bandwidth and the time taken to reach the app.
+# See Documentation/doc/development/benchmarking.adoc.
+
+import ../../lib/call-package.nix (
+{ callSpectrumPackage, writeScript, sysbench
+, memory ? {}
+}:
+
+callSpectrumPackage ../make-vm.nix {} {
+  inherit memory;
+  type = "nix";
+  run = writeScript "run-memory-benchmark" ''
+    #!/bin/execlineb -P
+    foreground {
+      redirfd -r 0 /proc/uptime
+      withstdinas -E uptime
+      echo "uptime at app start: ''${uptime}"
+    }
+    foreground {
+      ${sysbench}/bin/sysbench memory --memory-block-size=1M
+        --memory-total-size=32G --memory-oper=write run
+    }
+    foreground {
+      ${sysbench}/bin/sysbench memory --memory-block-size=1M
+        --memory-total-size=32G --memory-oper=read run
+    }
+    # Random accesses across a buffer much larger than the TLB covers
+    # with 4K pages.
+    ${sysbench}/bin/sysbench memory --memory-block-size=512M
+      --memory-total-size=8G --memory-access-mode=rnd run
+  '';
+}) (_: {})
@@ -6,7 +6,7 @@ import ../../../lib/call-package.nix (
 pkgsMusl.callPackage (
 
 { lib, stdenvNoCC, nixos, runCommand, writeClosure
-, erofs-utils, jq, s6-rc, util-linux, xorg
+, erofs-utils, s6-rc, xorg
 , busybox, dbus, execline, iwd, kmod, linuxPackagesFor, linux_latest
 , mdevd, nftables, s6, s6-linux-init, spectrum-driver-tools, xdp-tools
 }:
@@ -31,6 +31,8 @@ let
     structuredExtraConfig = with lib.kernel; {
       DRM_FBDEV_EMULATION = lib.mkForce no;
       EROFS_FS = yes;
+      EROFS_FS_ZIP_LZMA = yes;
+      EROFS_FS_ZIP_ZSTD = yes;
       FONTS = lib.mkForce unset;
       FONT_8x8 = lib.mkForce unset;
       FONT_TER16x32 = lib.mkForce unset;
@@ -111,13 +113,11 @@ stdenvNoCC.mkDerivation {
       ./.
       ../../../lib/common.mk
       ../../../scripts/make-erofs.sh
-      ../../../scripts/make-gpt.sh
-      ../../../scripts/sfdisk-field.awk
     ]);
   };
   sourceRoot = "source/vm/sys/net";
 
-  nativeBuildInputs = [ erofs-utils jq spectrum-build-tools s6-rc util-linux ];
+  nativeBuildInputs = [ erofs-utils spectrum-build-tools s6-rc ];
 
   env = {
     KERNEL = "${kernel}/${baseNameOf kernelTarget}";